@@ -1,3 +1,4 @@
+#include "build_cache.hpp"
 #include "container.hpp"
 #include "epub_options.hpp"
 #include "metadata.hpp"
@@ -16,13 +17,15 @@ int main(int argc, char **argv) {
     struct configuration : epub::configuration {
         std::filesystem::path basedir;
         bool omit_toc = false;
+        bool incremental = false;
     };
 
     auto config = std::make_shared<configuration>();
 
     epub::common_options(opt, config);
 
-    opt.synopsis() += " [--basedir=dir] [--omit-toc] content-file...";
+    opt.synopsis() +=
+        " [--basedir=dir] [--omit-toc] [--incremental] content-file...";
 
     opt.add_option(
         'b', "basedir",
@@ -36,6 +39,9 @@ int main(int argc, char **argv) {
     opt.add_flag(
         "omit-toc", [config] { config->omit_toc = true; },
         "do not include the ToC in the reading order");
+    opt.add_flag(
+        "incremental", [config] { config->incremental = true; },
+        "update an existing output, rewriting only what changed");
 
     std::vector<std::string> args{argv + 1, argv + argc};
 
@@ -52,6 +58,14 @@ int main(int argc, char **argv) {
 
     epub::container container{options};
 
+    if (config->output.empty()) config->output = "untitled.epub";
+    if (config->overwrite) std::filesystem::remove_all(config->output);
+
+    if (config->incremental) {
+        container.cache(std::make_shared<epub::build_cache>(
+            epub::build_cache::sidecar(config->output)));
+    }
+
     auto &metadata = container.package().metadata();
 
     metadata.title(std::move(config->title));
@@ -82,6 +96,9 @@ int main(int argc, char **argv) {
         }
     }
 
+    std::vector<epub::container::source_file> files;
+    files.reserve(args.size());
+
     for (std::string_view arg : args) {
         std::filesystem::path source, local;
 
@@ -100,15 +117,19 @@ int main(int argc, char **argv) {
             }
         }
 
-        container.add(source, local);
+        files.push_back({.source = std::move(source),
+                         .local = std::move(local)});
     }
 
-    if (config->output.empty()) config->output = "untitled.epub";
-    if (config->overwrite) std::filesystem::remove_all(config->output);
+    container.add(files, config->jobs);
 
     if (!config->toc_stylesheet.empty()) {
         container.toc_stylesheet(config->toc_stylesheet);
     }
 
-    container.write(config->output);
+    container.write(config->output, {.format = config->format,
+                                     .compression = config->compression,
+                                     .jobs = config->jobs,
+                                     .incremental = config->incremental,
+                                     .io_uring = config->io_uring});
 }
@@ -0,0 +1,258 @@
+#include "book.hpp"
+
+#include "logging.hpp"
+#include "packing.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <ranges>
+
+using namespace std::string_literals;
+
+template <std::size_t N>
+static inline std::string to_digits(std::unsigned_integral auto num) {
+    using namespace std::views;
+
+    std::string result(N, '0');
+
+    for (char &ch : result | reverse) {
+        ch = '0' + (num % 10);
+        num /= 10;
+    }
+
+    return result;
+}
+
+namespace epub::comic {
+
+namespace {
+
+/// Find the position of the first item and the space after each
+/// item, when @p count items of total length @p used share @p length.
+std::pair<float, float> spacing(separation_mode mode, std::size_t length,
+                                std::size_t used, std::size_t count) {
+    auto space = static_cast<float>(length - used);
+
+    switch (mode) {
+        case separation_mode::internal:
+            // A single row has no gaps to spread the space over.
+            if (count < 2) return {0, 0};
+            return {0, space / static_cast<float>(count - 1)};
+        case separation_mode::distributed:
+            return {space / static_cast<float>(count + 1),
+                    space / static_cast<float>(count + 1)};
+        case separation_mode::external:
+            return {space / 2, 0};
+        default:
+            throw std::invalid_argument{"book::layout"};
+    }
+}
+
+} // namespace
+
+void book::add_page() {
+    _pages.push_back({.number = ++_page_number,
+                      .first_row = static_cast<std::uint32_t>(_rows.size()),
+                      .content_height = 0});
+}
+
+void book::add_chapter(std::u8string name) {
+    _chapters.push_back(
+        {.name = std::move(name),
+         .first_page = static_cast<std::uint32_t>(_pages.size())});
+    add_page();
+}
+
+bool book::fits(std::size_t i, packing_mode mode) {
+    auto &page = _pages.back();
+    const auto w = _images.w[i], h = _images.h[i];
+
+    assert(w <= _page_size.w);
+    assert(h <= _page_size.h);
+
+    if (mode == packing_mode::shelved && page.first_row < _rows.size() &&
+        _row_width + w <= _page_size.w) {
+        auto height = std::max(_row_height, h);
+
+        if (page.content_height - _row_height + height <= _page_size.h) {
+            page.content_height += height - _row_height;
+            _row_height = height;
+            _row_width += w;
+            return true;
+        }
+    }
+
+    if (page.content_height + h > _page_size.h) return false;
+
+    page.content_height += h;
+    _row_height = h;
+    _row_width = w;
+
+    _rows.push_back(static_cast<std::uint32_t>(i));
+
+    return true;
+}
+
+void book::place_image(packing_mode mode) {
+    if (_placed >= _images.size() || _pages.empty()) {
+        throw std::out_of_range{__func__};
+    }
+
+    LOG(logging::INFO, "adding ",
+        std::filesystem::path{_images.path(_placed)}.filename(), " to ",
+        reinterpret_cast<const char *>(_chapters.back().name.c_str()));
+
+    if (!fits(_placed, mode)) {
+        LOG(logging::DEBUG, "overflow; adding new blank page");
+
+        add_page();
+        if (!fits(_placed, mode)) throw std::logic_error(__func__);
+    }
+
+    ++_placed;
+}
+
+void book::pop_blank_page() {
+    if (!_pages.empty() && _pages.back().first_row == _rows.size()) {
+        _pages.pop_back();
+    }
+}
+
+void book::balance() {
+    if (empty()) return;
+
+    const auto first_page = last_chapter().first_page;
+    if (first_page == _pages.size()) return;
+
+    const auto first_row = _pages[first_page].first_row;
+    const auto first = row_image(first_row);
+
+    std::vector<std::size_t> heights(_images.h.begin() + first,
+                                     _images.h.begin() + _placed);
+
+    auto breaks = balanced_breaks(heights, _page_size.h);
+    if (breaks.size() > _pages.size() - first_page) {
+        throw std::logic_error{__func__};
+    }
+
+    _rows.resize(first_row);
+    for (auto i = first; i < _placed; ++i) {
+        _rows.push_back(static_cast<std::uint32_t>(i));
+    }
+
+    breaks.push_back(heights.size());
+
+    for (std::size_t b = 0; b + 1 < breaks.size(); ++b) {
+        auto &page = _pages[first_page + b];
+
+        page.first_row = static_cast<std::uint32_t>(first_row + breaks[b]);
+        page.content_height = 0;
+
+        for (auto i = breaks[b]; i < breaks[b + 1]; ++i) {
+            page.content_height += static_cast<geom::coord>(heights[i]);
+        }
+
+        if (page.content_height > _page_size.h) {
+            throw std::logic_error{__func__};
+        }
+    }
+
+    _pages.resize(first_page + breaks.size() - 1);
+
+    if (!heights.empty()) {
+        _row_width = _images.w[_placed - 1];
+        _row_height = _images.h[_placed - 1];
+    }
+}
+
+void book::layout(std::size_t p, separation_mode mode) {
+    const auto &page = _pages[p];
+
+    if (page.content_height > _page_size.h) {
+        throw std::invalid_argument{__func__};
+    }
+
+    const auto first_row = page.first_row;
+    const auto last_row =
+        p + 1 < _pages.size() ? _pages[p + 1].first_row : _rows.size();
+
+    auto [origin_y, y_spacing] = spacing(mode, _page_size.h,
+                                         page.content_height,
+                                         last_row - first_row);
+
+    auto &x = _images.x, &y = _images.y, &w = _images.w, &h = _images.h;
+
+    for (auto r = first_row; r < last_row; ++r) {
+        const auto first = row_image(r), last = row_image(r + 1);
+
+        std::size_t row_width = 0;
+        geom::coord row_height = 0;
+        for (auto i = first; i < last; ++i) {
+            row_width += w[i];
+            row_height = std::max(row_height, h[i]);
+        }
+
+        // A lone image is centered, whatever the mode.
+        auto [origin_x, x_spacing] =
+            last - first == 1
+                ? spacing(separation_mode::external, _page_size.w,
+                          row_width, 1)
+                : spacing(mode, _page_size.w, row_width, last - first);
+
+        for (auto i = first; i < last; ++i) {
+            auto top = origin_y + static_cast<float>(row_height - h[i]) / 2;
+            x[i] = static_cast<geom::coord>(origin_x);
+            y[i] = static_cast<geom::coord>(top);
+            origin_x += static_cast<float>(w[i]);
+            origin_x += x_spacing;
+        }
+
+        origin_y += static_cast<float>(row_height);
+        origin_y += y_spacing;
+    }
+}
+
+std::filesystem::path book::page_path(std::size_t p) const {
+    return "pg"s + to_digits<4>(_pages[p].number) + ".xhtml"s;
+}
+
+std::u8string book::viewport() const {
+    auto s = "width="s + std::to_string(_page_size.w) + ", height="s +
+             std::to_string(_page_size.h);
+    return {s.begin(), s.end()};
+}
+
+void book::erase_front(std::size_t n) {
+    const auto rows = n < _pages.size() ? _pages[n].first_row : _rows.size();
+    const auto images = row_image(rows);
+
+    // Chapters are kept while any of their pages remain.
+    std::size_t done = 0;
+    while (done < _chapters.size() &&
+           (done + 1 < _chapters.size()
+                ? _chapters[done + 1].first_page <= n
+                : n == _pages.size())) {
+        ++done;
+    }
+
+    _chapters.erase(_chapters.begin(),
+                    _chapters.begin() + static_cast<std::ptrdiff_t>(done));
+    for (auto &ch : _chapters) {
+        ch.first_page = ch.first_page > n
+                            ? ch.first_page - static_cast<std::uint32_t>(n)
+                            : 0;
+    }
+
+    _pages.erase(_pages.begin(),
+                 _pages.begin() + static_cast<std::ptrdiff_t>(n));
+    for (auto &page : _pages) page.first_row -= rows;
+
+    _rows.erase(_rows.begin(),
+                _rows.begin() + static_cast<std::ptrdiff_t>(rows));
+    for (auto &row : _rows) row -= static_cast<std::uint32_t>(images);
+
+    _images.erase_front(images);
+    _placed -= images;
+}
+
+} // namespace epub::comic
@@ -1,35 +1,187 @@
 #ifndef _book_hpp_
 #define _book_hpp_
 
-#include "chapter.hpp"
+#include "constants.hpp"
 #include "geom.hpp"
+#include "image_table.hpp"
 
+#include <cstdint>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <utility>
 #include <vector>
 
 namespace epub::comic {
 
-class book : std::vector<chapter> {
+/// @brief The chapters and pages of a comic book.
+///
+/// The images are kept in an @c image_table, and the chapters, pages
+/// and rows (shelves) of images on a page are flat arrays of indices.
+/// Each holds the index of its first page, row or image and extends to
+/// the start of the next.
+///
+/// Images are placed on pages in the order they were added to the
+/// table.  Full pages may be written and removed from the front of the
+/// book while later images are still being placed.
+///
+class book {
+  public:
+    /// @brief A run of pages under one title.
+    struct chapter {
+        std::u8string name;       ///< The title of the chapter.
+        std::uint32_t first_page; ///< The index of its first page.
+        bool started = false;     ///< Whether a page has been written.
+    };
+
+    /// @brief A content page.
+    struct page {
+        unsigned number;            ///< The number naming its file.
+        std::uint32_t first_row;    ///< The index of its first row.
+        geom::coord content_height; ///< The total height of its rows.
+    };
+
+  private:
     geom::size _page_size;
+    image_table _images;
+    std::vector<chapter> _chapters;
+    std::vector<page> _pages;
+    std::vector<std::uint32_t> _rows;
+    std::size_t _placed = 0;
+    unsigned _page_number = 0;
+    geom::coord _row_width = 0;
+    geom::coord _row_height = 0;
+
+    void add_page();
+    bool fits(std::size_t image, packing_mode mode);
+    void erase_front(std::size_t n);
+
+    std::size_t row_image(std::size_t row) const {
+        return row < _rows.size() ? _rows[row] : _placed;
+    }
 
   public:
-    using vector::begin;
-    using vector::empty;
-    using vector::end;
+    explicit book(geom::size page_size)
+        : _page_size(page_size) {}
 
-    book(geom::size page_size)
-        : _page_size(std::move(page_size)) {}
+    /// @brief The size of every page.
+    const geom::size &page_size() const {
+        return _page_size;
+    }
+
+    /// @brief The images of the book, including those not yet placed.
+    auto &images() {
+        return _images;
+    }
+
+    /// @brief The images of the book, including those not yet placed.
+    const auto &images() const {
+        return _images;
+    }
 
-    /// @brief Checked version of vector::back().
+    /// @brief Whether the book has no chapters.
+    bool empty() const {
+        return _chapters.empty();
+    }
+
+    /// @brief Checked access to the last chapter.
     ///
-    /// @returns a reference to the last element
+    /// @returns a reference to the last chapter
     /// @throws std::out_of_range if the book has no chapters
-    auto &last_chapter() {
+    ///
+    const chapter &last_chapter() const {
         if (empty()) throw std::out_of_range{__func__};
-        return back();
+        return _chapters.back();
+    }
+
+    /// @brief Start a chapter on a new page.
+    ///
+    /// @param name the title of the chapter
+    ///
+    void add_chapter(std::u8string name);
+
+    /// @brief Place the next image on the last page.
+    ///
+    /// If the page does not have the space for the image, a new page
+    /// is started.  The image must already fit on a page.
+    ///
+    /// @param mode the placement of the image
+    /// @throws std::out_of_range if there is no image to place or no
+    ///   chapter to place it in
+    ///
+    void place_image(packing_mode mode = packing_mode::stacked);
+
+    /// @brief Remove the last page if it has no images.
+    void pop_blank_page();
+
+    /// @brief Move the page breaks of the last chapter so that white
+    /// space is spread evenly over its pages.
+    ///
+    /// Each image is given a row of its own, and the pages keep their
+    /// numbers.  See @c balanced_breaks for the partition used.
+    ///
+    void balance();
+
+    /// @brief Adjust the frames of the images on a page.
+    ///
+    /// The @c mode argument determines the disposition of white space
+    /// between the rows of the page and between the images of each
+    /// row.  Images shorter than their row are centered in it.
+    ///
+    /// @param p the index of the page
+    /// @param mode the disposition of white space on the page
+    ///
+    void layout(std::size_t p, separation_mode mode);
+
+    /// @brief The number of pages not yet removed.
+    std::size_t page_count() const {
+        return _pages.size();
     }
 
-    auto add_chapter(std::u8string name) {
-        return emplace_back(std::move(name), _page_size);
+    /// @brief The relative path of a content page.
+    std::filesystem::path page_path(std::size_t p) const;
+
+    /// @brief The indices of the first image of a page and past its
+    /// last image.
+    std::pair<std::size_t, std::size_t> page_images(std::size_t p) const {
+        auto last = p + 1 < _pages.size() ? _pages[p + 1].first_row
+                                          : _rows.size();
+        return {row_image(_pages[p].first_row), row_image(last)};
+    }
+
+    /// @brief The viewport of every page.
+    std::u8string viewport() const;
+
+    /// @brief Pass pages to a writer and remove them from the book.
+    ///
+    /// Pages are passed in order, except for the last @p keep pages,
+    /// which are kept for further images.  The images on the removed
+    /// pages are removed from the image table, and chapters with no
+    /// pages left are removed.
+    ///
+    /// @param keep the number of pages to keep
+    /// @param write called with the chapter, the index of each page
+    ///   and whether it is the first page of the chapter
+    ///
+    template <class Write>
+    void flush(std::size_t keep, Write &&write) {
+        if (_pages.size() <= keep) return;
+
+        const auto n = _pages.size() - keep;
+        std::size_t c = 0;
+
+        for (std::size_t p = 0; p < n; ++p) {
+            while (c + 1 < _chapters.size() &&
+                   _chapters[c + 1].first_page <= p) {
+                ++c;
+            }
+
+            auto &ch = _chapters[c];
+            write(static_cast<const chapter &>(ch), p, !ch.started);
+            ch.started = true;
+        }
+
+        erase_front(n);
     }
 };
 
@@ -0,0 +1,272 @@
+#include "build_cache.hpp"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace epub {
+
+namespace {
+
+constexpr std::string_view cache_header = "epubutil-cache 1";
+
+std::uint32_t update_crc(std::uint32_t crc, std::string_view data) {
+    while (!data.empty()) {
+        auto n = static_cast<uInt>(std::min<std::size_t>(
+            data.size(), std::numeric_limits<uInt>::max()));
+        crc = static_cast<std::uint32_t>(crc32(
+            crc, reinterpret_cast<const Bytef *>(data.data()), n));
+        data.remove_prefix(n);
+    }
+
+    return crc;
+}
+
+std::uint32_t checksum_file(const fs::path &path) {
+    std::ifstream in{path, std::ios::binary};
+    if (!in) {
+        throw fs::filesystem_error("unable to read", path,
+                                   std::io_errc::stream);
+    }
+
+    std::vector<char> buffer(64 * 1024);
+    auto size = static_cast<std::streamsize>(buffer.size());
+    auto crc = static_cast<std::uint32_t>(crc32(0L, Z_NULL, 0));
+
+    while (in.read(buffer.data(), size) || in.gcount() > 0) {
+        auto n = static_cast<std::size_t>(in.gcount());
+        crc = update_crc(crc, {buffer.data(), n});
+    }
+
+    if (in.bad()) {
+        throw fs::filesystem_error("unable to read", path,
+                                   std::io_errc::stream);
+    }
+
+    return crc;
+}
+
+// Fields are separated by tabs and records by newlines, so those (and
+// the escape character) are escaped within fields.
+
+template <class String>
+std::string escape(const String &field) {
+    std::string result;
+
+    for (auto ch : field) {
+        switch (ch) {
+            case '\\':
+                result += "\\\\";
+                break;
+            case '\t':
+                result += "\\t";
+                break;
+            case '\n':
+                result += "\\n";
+                break;
+            default:
+                result += static_cast<char>(ch);
+        }
+    }
+
+    return result;
+}
+
+std::string unescape(std::string_view field) {
+    std::string result;
+
+    for (auto p = field.begin(); p != field.end(); ++p) {
+        if (*p != '\\' || p + 1 == field.end()) {
+            result += *p;
+            continue;
+        }
+
+        switch (*++p) {
+            case 't':
+                result += '\t';
+                break;
+            case 'n':
+                result += '\n';
+                break;
+            default:
+                result += *p;
+        }
+    }
+
+    return result;
+}
+
+std::vector<std::string> split(std::string_view line) {
+    std::vector<std::string> fields;
+
+    for (;;) {
+        auto tab = line.find('\t');
+        fields.push_back(unescape(line.substr(0, tab)));
+        if (tab == line.npos) return fields;
+        line.remove_prefix(tab + 1);
+    }
+}
+
+std::u8string to_u8(const std::string &s) {
+    return {s.begin(), s.end()};
+}
+
+fs::path to_path(const std::string &s) {
+    return fs::path{to_u8(s)};
+}
+
+} // namespace
+
+build_cache::build_cache(fs::path path)
+    : _path(std::move(path)) {
+    std::ifstream in{_path};
+    std::string line;
+
+    if (!std::getline(in, line) || line != cache_header) return;
+
+    try {
+        source_record *record = nullptr;
+
+        while (std::getline(in, line)) {
+            auto fields = split(line);
+
+            if (fields[0] == "S" && fields.size() == 6) {
+                auto &r = _previous[to_path(fields[1])];
+                r.size = std::stoull(fields[2]);
+                r.mtime = std::stoll(fields[3]);
+                r.checksum = static_cast<std::uint32_t>(std::stoul(fields[4]));
+                r.entry = to_path(fields[5]);
+                record = &r;
+            }
+            else if (fields[0] == "M" && fields.size() == 3 && record) {
+                if (!record->metadata) record->metadata.emplace();
+                (*record->metadata)[to_u8(fields[1])] = to_u8(fields[2]);
+            }
+            else if (fields[0] == "D" && fields.size() == 3) {
+                _previous_documents[to_path(fields[1])] =
+                    static_cast<std::uint32_t>(std::stoul(fields[2]));
+            }
+            else {
+                throw std::invalid_argument{"unrecognized record"};
+            }
+        }
+    }
+    catch (const std::logic_error &) {
+        // A damaged cache only costs a full rebuild.
+        _previous.clear();
+        _previous_documents.clear();
+    }
+}
+
+build_cache::source_record &build_cache::current(const fs::path &source) {
+    if (auto found = _current.find(source); found != _current.end()) {
+        return found->second;
+    }
+
+    source_record r = {
+        .size = fs::file_size(source),
+        .mtime = fs::last_write_time(source).time_since_epoch().count(),
+    };
+
+    auto found = _previous.find(source);
+
+    if (found != _previous.end() && found->second.size == r.size &&
+        found->second.mtime == r.mtime) {
+        r.checksum = found->second.checksum;
+    }
+    else {
+        r.checksum = checksum_file(source);
+    }
+
+    return _current.emplace(source, std::move(r)).first->second;
+}
+
+const build_cache::source_record *
+build_cache::previous(const fs::path &source) {
+    auto &c = current(source);
+
+    auto found = _previous.find(source);
+    if (found == _previous.end()) return nullptr;
+
+    const auto &p = found->second;
+    return p.size == c.size && p.checksum == c.checksum ? &p : nullptr;
+}
+
+std::optional<file_metadata> build_cache::metadata(const fs::path &source) {
+    auto p = previous(source);
+    return p ? p->metadata : std::nullopt;
+}
+
+void build_cache::metadata(const fs::path &source,
+                           const file_metadata &metadata) {
+    current(source).metadata = metadata;
+}
+
+bool build_cache::unchanged(const fs::path &source, const fs::path &entry) {
+    current(source).entry = entry;
+
+    auto p = previous(source);
+    return p && p->entry == entry;
+}
+
+bool build_cache::unchanged_document(const fs::path &entry,
+                                     std::uint32_t checksum) {
+    _current_documents[entry] = checksum;
+
+    auto found = _previous_documents.find(entry);
+    return found != _previous_documents.end() && found->second == checksum;
+}
+
+std::uint32_t build_cache::checksum(std::string_view data) {
+    return update_crc(static_cast<std::uint32_t>(crc32(0L, Z_NULL, 0)),
+                      data);
+}
+
+std::uint32_t build_cache::checksum(std::uint32_t crc,
+                                    std::string_view data) {
+    return update_crc(crc, data);
+}
+
+void build_cache::save() const {
+    auto temporary = _path;
+    temporary += ".tmp";
+
+    {
+        std::ofstream out{temporary};
+
+        out << cache_header << '\n';
+
+        for (auto &&[source, r] : _current) {
+            out << "S\t" << escape(source.u8string()) << '\t' << r.size
+                << '\t' << r.mtime << '\t' << r.checksum << '\t'
+                << escape(r.entry.u8string()) << '\n';
+
+            if (!r.metadata) continue;
+
+            for (auto &&[key, value] : *r.metadata) {
+                out << "M\t" << escape(key) << '\t' << escape(value) << '\n';
+            }
+        }
+
+        for (auto &&[entry, checksum] : _current_documents) {
+            out << "D\t" << escape(entry.u8string()) << '\t' << checksum
+                << '\n';
+        }
+
+        if (!out.flush()) {
+            throw fs::filesystem_error("unable to write", temporary,
+                                       std::io_errc::stream);
+        }
+    }
+
+    fs::rename(temporary, _path);
+}
+
+} // namespace epub
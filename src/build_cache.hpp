@@ -0,0 +1,135 @@
+#ifndef _build_cache_hpp_
+#define _build_cache_hpp_
+
+#include "file_metadata.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <string_view>
+
+namespace epub {
+
+/// @brief A record of a previous build, used to skip unchanged work.
+///
+/// The cache is kept in a sidecar file next to the publication.  For
+/// every source it holds the size, modification time and a checksum of
+/// the contents, the container entry it was written to, and any
+/// metadata parsed from it.  Generated documents are recorded by
+/// checksum.
+///
+/// A source is unchanged if its size and modification time match the
+/// previous build, or failing that, if its contents have the same
+/// checksum.  Only what is looked up during a build is saved, so
+/// sources that are no longer used are forgotten.
+///
+class build_cache {
+  public:
+    struct source_record {
+        std::uintmax_t size = 0;
+        std::int64_t mtime = 0;
+        std::uint32_t checksum = 0;
+        std::filesystem::path entry;
+        std::optional<file_metadata> metadata;
+    };
+
+  private:
+    std::filesystem::path _path;
+
+    std::map<std::filesystem::path, source_record> _previous;
+    std::map<std::filesystem::path, source_record> _current;
+
+    std::map<std::filesystem::path, std::uint32_t> _previous_documents;
+    std::map<std::filesystem::path, std::uint32_t> _current_documents;
+
+    const source_record *previous(const std::filesystem::path &source);
+    source_record &current(const std::filesystem::path &source);
+
+  public:
+    /// @brief Load the cache from @p path.
+    ///
+    /// A missing or unreadable cache file is treated as empty, so that
+    /// everything is rebuilt.
+    ///
+    /// @param path the sidecar file
+    ///
+    explicit build_cache(std::filesystem::path path);
+
+    /// @brief The name of the sidecar file for a publication.
+    ///
+    /// @param output the name of the publication
+    /// @returns @p output with @c ".cache" appended
+    ///
+    static std::filesystem::path
+    sidecar(const std::filesystem::path &output) {
+        auto path = output;
+        return path += ".cache";
+    }
+
+    /// @brief Metadata parsed from an unchanged source.
+    ///
+    /// @param source the source file
+    /// @returns the metadata recorded by the previous build, or an
+    ///   empty optional if there is none or the source has changed
+    ///
+    std::optional<file_metadata> metadata(const std::filesystem::path &source);
+
+    /// @brief Record the metadata parsed from a source.
+    ///
+    /// @param source the source file
+    /// @param metadata the metadata
+    ///
+    void metadata(const std::filesystem::path &source,
+                  const file_metadata &metadata);
+
+    /// @brief Check whether a source can be reused.
+    ///
+    /// Also records @p entry as the destination of @p source.
+    ///
+    /// @param source the source file
+    /// @param entry the container entry it is written to
+    /// @returns true if the source is unchanged and was written to the
+    ///   same entry by the previous build
+    ///
+    bool unchanged(const std::filesystem::path &source,
+                   const std::filesystem::path &entry);
+
+    /// @brief Check whether a generated document can be reused.
+    ///
+    /// Also records @p checksum for @p entry.
+    ///
+    /// @param entry the container entry
+    /// @param checksum a checksum of the document
+    /// @returns true if the previous build wrote a document with the
+    ///   same checksum to @p entry
+    ///
+    bool unchanged_document(const std::filesystem::path &entry,
+                            std::uint32_t checksum);
+
+    /// @brief Compute the checksum used to compare contents.
+    ///
+    /// @param data the contents
+    /// @returns the CRC-32 of @p data
+    ///
+    static std::uint32_t checksum(std::string_view data);
+
+    /// @brief Continue a checksum with more of the contents.
+    ///
+    /// @param crc the checksum of the contents before @p data
+    /// @param data the contents that follow
+    /// @returns the checksum of the contents so far
+    ///
+    static std::uint32_t checksum(std::uint32_t crc, std::string_view data);
+
+    /// @brief Write what was recorded during this build.
+    ///
+    /// @throws std::filesystem::filesystem_error if the file cannot be
+    ///   written
+    ///
+    void save() const;
+};
+
+} // namespace epub
+
+#endif
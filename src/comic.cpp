@@ -1,19 +1,22 @@
 #include "container.hpp"
 #include "epub_options.hpp"
 #include "file_metadata.hpp"
-#include "minidom.hpp"
+#include "frame_styles.hpp"
 #include "options.hpp"
+#include "page_template.hpp"
 #include "book.hpp"
-#include "chapter.hpp"
 #include "geom.hpp"
+#include "image_cache.hpp"
 #include "image_ref.hpp"
+#include "image_table.hpp"
 #include "logging.hpp"
-#include "page.hpp"
+#include "resample.hpp"
+#include "worker_pool.hpp"
 #include "xml.hpp"
 
 using epub::comic::book;
-using epub::comic::chapter;
 using epub::comic::image_ref;
+using epub::comic::packing_mode;
 using epub::comic::separation_mode;
 
 int main(int argc, char **argv) {
@@ -22,7 +25,13 @@ int main(int argc, char **argv) {
     struct configuration : epub::configuration {
         geom::size page_size = {1536U, 2048U};
         bool upscale = false;
+        bool downscale = false;
         separation_mode spacing = separation_mode::distributed;
+        packing_mode packing = packing_mode::stacked;
+        bool frame_classes = false;
+        bool balance_pages = false;
+        bool stream = false;
+        std::filesystem::path image_cache;
         std::filesystem::copy_options image_copy_options =
             std::filesystem::copy_options::none;
     };
@@ -32,7 +41,9 @@ int main(int argc, char **argv) {
     epub::common_options(opt, config);
 
     opt.synopsis() +=
-        " [--verbose] [--link] [--upscale]"
+        " [--verbose] [--link] [--upscale] [--downscale] [--frame-classes]"
+        " [--balance-pages | --columns] [--stream]"
+        " [--image-cache=file]"
         " [--page-size=WIDTHxHEIGHT | --width=WIDTH --height=HEIGHT]"
         " image-file...";
 
@@ -50,6 +61,10 @@ int main(int argc, char **argv) {
     opt.add_flag(
         'u', "upscale", [config] { config->upscale = true; },
         "scale images up to fit page widths");
+    opt.add_flag(
+        "downscale", [config] { config->downscale = true; },
+        "resample images larger than the page down to the size shown "
+        "(JPEG and PNG only)");
     opt.add_option(
         'p', "page-size",
         [config](const std::string &arg) {
@@ -85,6 +100,23 @@ int main(int argc, char **argv) {
         "spread-frames",
         [config] { config->spacing = separation_mode::internal; },
         "maximize space between images");
+    opt.add_flag(
+        "balance-pages", [config] { config->balance_pages = true; },
+        "spread white space evenly over the pages of each chapter");
+    opt.add_flag(
+        "columns", [config] { config->packing = packing_mode::shelved; },
+        "place narrow images side by side");
+    opt.add_flag(
+        "stream", [config] { config->stream = true; },
+        "write each page as soon as it is full");
+
+    opt.add_flag(
+        "frame-classes", [config] { config->frame_classes = true; },
+        "position images with classes from a shared stylesheet");
+    opt.add_option(
+        "image-cache",
+        [config](const std::string &arg) { config->image_cache = arg; },
+        "reuse image dimensions recorded in this file between runs");
 
     std::vector<std::string> args(argv + 1, argv + argc);
 
@@ -117,49 +149,14 @@ int main(int argc, char **argv) {
         exit(1);
     }
 
-    if (config->output.empty()) config->output = "untitled.epub";
-
-    book the_book{config->page_size};
-
-    unsigned page_num = 0U;
-    unsigned img_num = 0U;
-
-    for (auto &&path : args) {
-        auto chapter_name = std::filesystem::absolute(path)
-                                .parent_path()
-                                .filename()
-                                .u8string();
-
-        if (chapter_name.empty()) {
-            throw std::runtime_error{"cannot work in root directory"};
-        }
-
-        if (the_book.empty() ||
-            the_book.last_chapter().name != chapter_name) {
-            the_book.add_chapter(chapter_name);
-            the_book.last_chapter().add_blank_page(++page_num);
-        }
-
-        auto &current_chapter = the_book.last_chapter();
-
-        image_ref image{path, ++img_num};
-
-        auto scale = image.frame.fit(config->page_size);
-
-        if (scale > 1.0 && config->upscale) {
-            image.frame *= scale;
-        }
-
-        current_chapter.add_image(image, page_num);
+    if (config->balance_pages && config->packing != packing_mode::stacked) {
+        std::cerr << "error: --balance-pages cannot be used with --columns\n"
+                  << std::endl;
+        opt.usage();
+        exit(1);
     }
 
-    the_book.last_chapter().pop_blank_page();
-
-    for (auto &&chapter : the_book) {
-        for (auto &&page : chapter) {
-            page.layout(config->spacing);
-        }
-    }
+    if (config->output.empty()) config->output = "untitled.epub";
 
     if (config->overwrite) remove_all(config->output);
 
@@ -186,84 +183,297 @@ int main(int argc, char **argv) {
     const epub::file_metadata page_metadata{
         {u8"title", u8"-"}, {u8"media-type", u8"application/xhtml+xml"}};
 
-    for (auto &&chapter : the_book) {
-        bool first = true;
+    const std::filesystem::path content_dir = "Contents";
+    const std::filesystem::path frames_css = "frames.css";
 
-        for (auto &&page : chapter) {
-            epub::manifest_item item = {
-                .id = page.path.stem().u8string(),
-                .path = page.path,
-                .metadata = page_metadata,
-                .in_spine = true,
-            };
+#ifdef USER_STYLE
+    const std::u8string_view user_style = u8 USER_STYLE;
+#else
+    const std::u8string_view user_style;
+#endif
+
+    const auto link =
+        config->frame_classes ? frames_css.u8string() : std::u8string{};
+    const epub::xml::page_template page_template{u8"Comic Page",
+                                                 user_style, link};
+
+    // Frames are interned in reading order so that the class names do
+    // not depend on anything but the layout.
+
+    epub::comic::frame_styles frames;
+
+    // The output is opened when the first page is written, so that
+    // nothing is written if an image cannot be read before then, or
+    // at the end if there are no pages.
+
+    std::unique_ptr<epub::output> out;
+
+    auto open_output = [&] {
+        if (out) return;
+        out = epub::open_output(config->output,
+                                {.format = config->format,
+                                 .copy_options = config->image_copy_options,
+                                 .compression = config->compression,
+                                 .jobs = config->jobs,
+                                 .io_uring = config->io_uring});
+    };
+
+    book the_book{config->page_size};
+    const auto viewport = the_book.viewport();
+
+    // Pages are independent once packed, so they are laid out and
+    // rendered by a pool of workers a window at a time.  They are
+    // then added to the manifest and written in order, so that the
+    // output does not depend on the number of jobs.
+
+    // Resampled images are held until their page is written, so then
+    // the window is smaller.
+
+    const std::size_t page_window = config->downscale ? 32 : 256;
+
+    std::unique_ptr<epub::worker_pool> pool;
+    if (config->jobs != 1) {
+        pool = std::make_unique<epub::worker_pool>(config->jobs);
+    }
 
-            if (first) {
-                item.in_toc = true;
-                item.metadata[u8"title"] = chapter.name;
-                first = false;
+    auto for_each_page = [&](std::size_t n, auto &&fn) {
+        if (!pool || n < 2) {
+            for (std::size_t p = 0; p < n; ++p) fn(p);
+            return;
+        }
+
+        // A task per page would cost more in queueing than the work
+        // itself, so each task takes a run of pages.
+        const auto tasks = std::min(n, 4 * pool->size());
+        std::vector<std::future<void>> done;
+        done.reserve(tasks);
+
+        for (std::size_t t = 0; t < tasks; ++t) {
+            done.push_back(pool->submit([&fn, n, tasks, t] {
+                for (auto p = n * t / tasks; p < n * (t + 1) / tasks; ++p) {
+                    fn(p);
+                }
+            }));
+        }
+
+        for (auto &&f : done) f.get();
+    };
+
+    std::vector<std::string> documents(page_window);
+    std::vector<std::u8string> class_names;
+    std::vector<std::optional<std::string>> resampled;
+
+    auto render_page = [&](std::size_t p) {
+        const auto &table = the_book.images();
+        auto [begin, end] = the_book.page_images(p);
+
+        std::vector<std::u8string> styles, sources;
+        std::vector<epub::xml::page_image> images;
+
+        for (auto i = begin; i < end; ++i) {
+            sources.push_back(table.local(i).u8string());
+            if (!config->frame_classes) {
+                styles.push_back(epub::comic::inline_style(table.frame(i)));
             }
+        }
 
-            c.package().add_to_manifest(std::move(item));
+        for (auto i = begin; i < end; ++i) {
+            if (config->frame_classes) {
+                images.push_back({.class_name = class_names[i],
+                                  .src = sources[i - begin]});
+            }
+            else {
+                images.push_back(
+                    {.style = styles[i - begin], .src = sources[i - begin]});
+            }
+        }
 
-            for (auto &&image : page) {
-                epub::manifest_item image_item = {
-                    .id = image.local.stem().u8string(),
-                    .path = image.local,
-                    .metadata = {{u8"media-type", image.media_type}},
-                };
-                c.package().add_to_manifest(std::move(image_item));
+        page_template.render(documents[p], viewport, images);
+    };
+
+    auto resample_page = [&](std::size_t p) {
+        const auto &table = the_book.images();
+        auto [begin, end] = the_book.page_images(p);
+
+        for (auto i = begin; i < end; ++i) {
+            auto source = table.source_size(i);
+            if (table.w[i] < source.w || table.h[i] < source.h) {
+                resampled[i] = epub::comic::resample(
+                    std::filesystem::path{table.path(i)},
+                    table.media_type(i), {table.w[i], table.h[i]});
             }
         }
-    }
+    };
 
-    if (!config->cover_image.empty()) {
-        image_ref cover{config->cover_image, "cover"};
-        c.add(cover.path, cover.local, u8"cover-image");
-    }
+    // Lay out and render the first n pages, resampling their images.
+    auto prepare_pages = [&](std::size_t n) {
+        if (config->downscale) {
+            resampled.assign(the_book.page_images(n - 1).second,
+                             std::nullopt);
+        }
 
-    c.write(config->output);
+        for_each_page(n, [&](std::size_t p) {
+            the_book.layout(p, config->spacing);
+            if (config->downscale) resample_page(p);
+            if (!config->frame_classes) render_page(p);
+        });
 
-    auto content_dir = config->output / "Contents";
+        if (config->frame_classes) {
+            const auto &table = the_book.images();
+            const auto last = the_book.page_images(n - 1).second;
 
-    for (auto &&chapter : the_book) {
-        for (auto &&page : chapter) {
-            using namespace epub::xml;
+            class_names.resize(last);
+            for (std::size_t i = the_book.page_images(0).first; i < last;
+                 ++i) {
+                class_names[i] = frames.class_name(table.frame(i));
+            }
 
-            auto doc = new_doc();
-            auto root = new_node(doc, nullptr, u8"html");
+            for_each_page(n, render_page);
+        }
+    };
 
-            set_ns(root, new_ns(root, xhtml_ns_uri));
-            set_root_element(doc, root);
+    auto write_page = [&](const book::chapter &chapter, std::size_t p,
+                          bool first) {
+        open_output();
 
-            auto head = new_child_node(root, nullptr, u8"head");
-            auto body = new_child_node(root, nullptr, u8"body");
+        auto path = the_book.page_path(p);
 
-            auto title =
-                new_child_node(head, nullptr, u8"title", u8"Comic Page");
+        epub::manifest_item item = {
+            .id = path.stem().u8string(),
+            .path = path,
+            .metadata = page_metadata,
+            .in_spine = true,
+        };
 
-            auto meta = new_child_node(head, nullptr, u8"meta");
-            set_attribute(meta, u8"name", u8"viewport");
-            set_attribute(meta, u8"content", page.viewport());
+        if (first) {
+            item.in_toc = true;
+            item.metadata[u8"title"] = chapter.name;
+        }
 
-#ifdef USER_STYLE
-            auto style = new_child_node(head, nullptr, u8"style");
-            set_attribute(style, u8"type", u8"text/css");
-            auto cdata = new_cdata(doc, u8 USER_STYLE);
-            add_child(style, cdata);
-#endif
+        c.package().add_to_manifest(std::move(item));
 
-            for (auto &&image : page) {
-                auto img = new_child_node(body, nullptr, u8"img");
-                set_attribute(img, u8"style",
-                              reinterpret_cast<const char8_t *>(
-                                  image.style().c_str()));
-                set_attribute(img, u8"src", image.local.u8string());
+        const auto &table = the_book.images();
+        auto [begin, end] = the_book.page_images(p);
 
-                copy(image.path, content_dir / image.local,
-                     config->image_copy_options);
+        for (auto i = begin; i < end; ++i) {
+            auto local = table.local(i);
+
+            epub::manifest_item image_item = {
+                .id = local.stem().u8string(),
+                .path = local,
+                .metadata = {{u8"media-type",
+                              std::u8string{table.media_type(i)}}},
+            };
+            c.package().add_to_manifest(std::move(image_item));
+
+            if (config->downscale && resampled[i]) {
+                out->write(content_dir / local, *resampled[i]);
+                resampled[i].reset();
+            }
+            else {
+                out->copy(content_dir / local, table.path(i));
             }
+        }
+
+        out->write(content_dir / path, documents[p]);
+    };
 
-            save_file(content_dir / page.path, doc, true);
+    // Write all but the last keep pages, a window at a time.
+    auto write_pages = [&](std::size_t keep) {
+        while (the_book.page_count() > keep) {
+            auto n = std::min(the_book.page_count() - keep, page_window);
+            prepare_pages(n);
+            the_book.flush(the_book.page_count() - n, write_page);
         }
+    };
+
+    auto finish_chapter = [&] {
+        if (config->balance_pages) the_book.balance();
+        if (config->stream) write_pages(0);
+    };
+
+    std::unique_ptr<epub::comic::image_cache> cache;
+    if (!config->image_cache.empty()) {
+        cache = std::make_unique<epub::comic::image_cache>(config->image_cache);
     }
+
+    // Images are probed, added and scaled in batches, so that when
+    // streaming only one batch of headers is held at a time.
+
+    constexpr std::size_t probe_batch = 1024;
+
+    for (std::size_t next = 0; next < args.size(); next += probe_batch) {
+        auto batch = std::span<const std::string>{args}.subspan(
+            next, std::min(probe_batch, args.size() - next));
+
+        auto infos =
+            epub::comic::probe_images(batch, config->jobs, cache.get());
+
+        auto &table = the_book.images();
+        const auto first = table.size();
+
+        for (std::size_t i = 0; i < batch.size(); ++i) {
+            table.add(batch[i], infos[i]);
+        }
+
+        if (config->upscale) {
+            table.fit(first, table.size(), config->page_size, true);
+        }
+        table.fit(first, table.size(), config->page_size);
+
+        for (auto &&path : batch) {
+            auto chapter_name = std::filesystem::absolute(path)
+                                    .parent_path()
+                                    .filename()
+                                    .u8string();
+
+            if (chapter_name.empty()) {
+                throw std::runtime_error{"cannot work in root directory"};
+            }
+
+            if (the_book.empty() ||
+                the_book.last_chapter().name != chapter_name) {
+                if (!the_book.empty()) finish_chapter();
+                the_book.add_chapter(chapter_name);
+            }
+
+            the_book.place_image(config->packing);
+
+            // Balancing moves breaks anywhere in the chapter, so then
+            // pages are only written when the chapter is finished.
+            // Otherwise they are written once a window is full, so
+            // that the workers have a window's worth to share.
+
+            if (config->stream && !config->balance_pages &&
+                the_book.page_count() > page_window) {
+                write_pages(1);
+            }
+        }
+    }
+
+    if (cache) cache->save();
+
+    the_book.pop_blank_page();
+    if (config->balance_pages) the_book.balance();
+    write_pages(0);
+    open_output();
+
+    if (config->frame_classes) {
+        c.package().add_to_manifest({
+            .id = u8"frames",
+            .path = frames_css,
+            .metadata = {{u8"media-type", u8"text/css"}},
+        });
+
+        out->write(content_dir / frames_css, frames.stylesheet());
+    }
+
+    if (!config->cover_image.empty()) {
+        image_ref cover{config->cover_image, "cover"};
+        c.add(cover.path, cover.local, u8"cover-image");
+    }
+
+    c.write(*out);
+
+    out->close();
 }
@@ -4,12 +4,22 @@
 namespace epub::comic {
 
 /// @brief Spacing of multiple images on a page.
+///
+/// The mode applies along both axes: to the rows of a page and to the
+/// images within each row.  An image alone in its row is centered.
+///
 enum class separation_mode {
     external,    ///< Place maximum space between images.
     distributed, ///< Evenly space images.
     internal,    ///< Place no space between images.
 };
 
+/// @brief Placement of images on a page.
+enum class packing_mode {
+    stacked, ///< Place each image below the last.
+    shelved, ///< Place images side by side in rows, left to right.
+};
+
 } // namespace epub::comic
 
 #endif
@@ -1,15 +1,92 @@
 #include "container.hpp"
 
+#include "build_cache.hpp"
 #include "manifest_item.hpp"
 #include "media_type.hpp"
+#include "worker_pool.hpp"
 #include "xml.hpp"
 
-#include <fstream>
+#include <array>
+#include <functional>
+#include <future>
+#include <map>
+#include <ostream>
+#include <streambuf>
+#include <vector>
 
 namespace fs = std::filesystem;
 
 namespace epub {
 
+namespace {
+
+/// Computes @c build_cache::checksum of what is written to it without
+/// keeping the data.
+///
+/// The modification time differs on every build, so when
+/// @c skip_modified is set it is left out when deciding whether the
+/// package document has changed.
+class checksum_buf : public std::streambuf {
+    static constexpr std::string_view marker = "\"dcterms:modified\">";
+
+    std::array<char, 4096> _buffer;
+    bool _skip;
+    bool _skipping = false;
+    std::size_t _matched = 0;
+
+    void process() {
+        auto run = pbase();
+        auto add = [&](const char *end) {
+            _crc = build_cache::checksum(
+                _crc, {run, static_cast<std::size_t>(end - run)});
+        };
+
+        for (auto p = pbase(); _skip && p != pptr(); ++p) {
+            if (_skipping) {
+                if (*p != '<') continue;
+                run = p;
+                _skipping = _skip = false;
+            }
+            else if (*p == marker[_matched]) {
+                if (++_matched == marker.size()) {
+                    add(p + 1);
+                    _skipping = true;
+                }
+            }
+            else {
+                _matched = *p == marker[0] ? 1 : 0;
+            }
+        }
+
+        if (!_skipping) add(pptr());
+        setp(_buffer.data(), _buffer.data() + _buffer.size());
+    }
+
+    std::uint32_t _crc = build_cache::checksum({});
+
+  protected:
+    int_type overflow(int_type ch) override {
+        process();
+        if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(ch);
+            pbump(1);
+        }
+        return traits_type::not_eof(ch);
+    }
+
+  public:
+    explicit checksum_buf(bool skip_modified) : _skip(skip_modified) {
+        setp(_buffer.data(), _buffer.data() + _buffer.size());
+    }
+
+    std::uint32_t checksum() {
+        process();
+        return _crc;
+    }
+};
+
+} // namespace
+
 container::container(container::options options) {
     file_metadata metadata = {
         {u8"title", u8"Table of Contents"},
@@ -31,34 +108,74 @@ container::container(container::options options) {
     _package.add_to_manifest(std::move(item));
 }
 
-void container::add(const std::filesystem::path &source,
-                    const std::filesystem::path &local,
-                    std::u8string properties) {
+struct container::registration {
+    fs::path source;
+    fs::path key;
+    manifest_item item;
+    std::u8string media_type;
+
+    /// @brief Whether the metadata must be parsed from the source.
+    bool probe = false;
+};
+
+container::registration
+container::register_file(const std::filesystem::path &source,
+                         const std::filesystem::path &local,
+                         std::u8string properties) {
     auto key = "Contents" / local.lexically_normal();
 
     if (auto found = _files.find(key); found != _files.end()) {
         throw duplicate_error(source, found->second);
     }
 
-    _files.emplace(std::move(key), source.lexically_normal());
-
-    manifest_item item = {
-        .path = std::move(local),
-        .properties = std::move(properties),
+    // The source is normalized once so that the cache sees the same
+    // path here, in merge() and in write().
+    registration r = {
+        .source = source.lexically_normal(),
+        .key = std::move(key),
+        .item =
+            {
+                .path = local,
+                .properties = std::move(properties),
+            },
     };
 
-    std::u8string media_type;
-
     try {
-        media_type = guess_media_type(item.path);
+        r.media_type = guess_media_type(r.item.path);
     }
     catch (const std::out_of_range &ex) {
         std::throw_with_nested(std::invalid_argument(
             __func__ + std::string{": unknown file type"}));
     }
 
-    if (media_type == xhtml_media_type) {
-        xml::get_xhtml_metadata(source, item.metadata);
+    if (r.media_type == xhtml_media_type) {
+        if (auto cached = _cache ? _cache->metadata(r.source)
+                                 : std::nullopt) {
+            r.item.metadata = std::move(*cached);
+        }
+        else {
+            r.probe = true;
+        }
+    }
+    else if (r.media_type == svg_media_type) {
+        throw std::logic_error("Not yet implemented");
+        /// @todo xml::get_svg_metadata(source, metadata)
+    }
+
+    return r;
+}
+
+void container::probe(registration &r) {
+    xml::get_xhtml_metadata(r.source, r.item.metadata);
+}
+
+void container::merge(registration &&r) {
+    _files.emplace(std::move(r.key), r.source);
+
+    auto &item = r.item;
+
+    if (r.media_type == xhtml_media_type) {
+        if (_cache) _cache->metadata(r.source, item.metadata);
 
         if (auto props = item.metadata.get(u8"properties"); props) {
             if (!item.properties.empty()) item.properties += u8' ';
@@ -72,10 +189,7 @@ void container::add(const std::filesystem::path &source,
             }
         }
     }
-    else if (media_type == svg_media_type) {
-        throw std::logic_error("Not yet implemented");
-        /// @todo xml::get_svg_metadata(source, metadata)
-
+    else if (r.media_type == svg_media_type) {
         if (auto props = item.metadata.get(u8"properties"); props) {
             if (!item.properties.empty()) item.properties += u8' ';
             item.properties += *props;
@@ -89,39 +203,102 @@ void container::add(const std::filesystem::path &source,
         }
     }
 
-    item.metadata[u8"media-type"] = std::move(media_type);
+    item.metadata[u8"media-type"] = std::move(r.media_type);
 
     _package.add_to_manifest(std::move(item));
 }
 
-template <class String>
-static void write_file(const fs::path &path, String &&string) {
-    if (!(std::ofstream{path} << std::forward<String>(string))) {
-        throw fs::filesystem_error("unable to write", path,
-                                   std::io_errc::stream);
-    }
+void container::add(const std::filesystem::path &source,
+                    const std::filesystem::path &local,
+                    std::u8string properties) {
+    auto r = register_file(source, local, std::move(properties));
+    if (r.probe) probe(r);
+    merge(std::move(r));
 }
 
-void container::write(const fs::path &path) const {
-    if (exists(path)) {
-        throw fs::filesystem_error(
-            "container::write", path,
-            std::make_error_code(std::errc::file_exists));
+void container::add(std::span<const source_file> files, unsigned jobs) {
+    std::vector<registration> pending;
+    pending.reserve(files.size());
+
+    // Nothing is added to the container until every file has been
+    // registered and parsed, so a failure leaves it unchanged.  Names
+    // are checked against the rest of the batch here, and against the
+    // container by register_file.
+    std::map<fs::path, fs::path> batch;
+
+    for (auto &&f : files) {
+        auto r = register_file(f.source, f.local, f.properties);
+        auto [found, added] = batch.emplace(r.key, r.source);
+        if (!added) throw duplicate_error(f.source, found->second);
+        pending.push_back(std::move(r));
+    }
+
+    if (jobs != 1 && pending.size() > 1) {
+        worker_pool pool{jobs};
+        std::vector<std::future<void>> probes;
+
+        for (auto &&r : pending) {
+            if (r.probe) probes.push_back(pool.submit([&r] { probe(r); }));
+        }
+
+        // Rethrow the first failure in argument order; the pool
+        // finishes the remaining tasks before it is destroyed.
+        for (auto &&f : probes) f.get();
+    }
+    else {
+        for (auto &&r : pending) {
+            if (r.probe) probe(r);
+        }
     }
 
-    create_directory(path);
+    for (auto &&r : pending) merge(std::move(r));
+}
+
+void container::write(const fs::path &path,
+                      const output_options &options) const {
+    auto out = open_output(path, options);
+    write(*out);
+    out->close();
+
+    if (_cache) _cache->save();
+}
 
-    write_file(path / "mimetype", "application/epub+zip");
+void container::write(output &out) const {
+    using generator = std::function<void(std::ostream &)>;
 
-    auto meta_inf_dir = path / "META-INF";
-    create_directory(meta_inf_dir);
+    // The documents are generated twice when there is a cache, once to
+    // compare them with the previous build and once to write them, so
+    // that they are never held in memory.
+    auto document = [&](const fs::path &local, const generator &fn,
+                        bool skip_modified = false) {
+        if (_cache) {
+            checksum_buf sum{skip_modified};
+            std::ostream sink{&sum};
+            fn(sink);
+            if (_cache->unchanged_document(local, sum.checksum()) &&
+                out.keep(local)) {
+                return;
+            }
+        }
+        out.generate(local, fn);
+    };
 
-    xml::write_container(path, *this);
+    document("META-INF/container.xml", [](std::ostream &os) {
+        os << xml::container_document();
+    });
+    document(
+        "Contents/package.opf",
+        [&](std::ostream &os) { xml::package_document(os, _package); },
+        true);
+    document("Contents/nav.xhtml", [&](std::ostream &os) {
+        xml::navigation_document(os, *this);
+    });
 
     for (auto &[key, source] : _files) {
-        auto local = path / key;
-        create_directories(local.parent_path());
-        copy_file(source, local);
+        if (_cache && _cache->unchanged(source, key) && out.keep(key)) {
+            continue;
+        }
+        out.copy(key, source);
     }
 }
 
@@ -1,14 +1,19 @@
 #ifndef _container_hpp_
 #define _container_hpp_
 
+#include "output.hpp"
 #include "package.hpp"
 
 #include <filesystem>
 #include <map>
+#include <memory>
+#include <span>
 #include <type_traits>
 
 namespace epub {
 
+class build_cache;
+
 /// @brief An exception indicating a duplicate local path.
 class duplicate_error : public std::filesystem::filesystem_error {
   public:
@@ -68,9 +73,32 @@ class container {
     /// of contents.
     std::filesystem::path _toc_stylesheet;
 
+    /// @brief The record of the previous build, if any.
+    std::shared_ptr<build_cache> _cache;
+
+    /// @brief A file that has been registered but not yet added to
+    /// the manifest.
+    struct registration;
+
+    registration register_file(const std::filesystem::path &source,
+                               const std::filesystem::path &local,
+                               std::u8string properties);
+    static void probe(registration &r);
+    void merge(registration &&r);
+
   public:
     enum class options { none = 0, omit_toc = 1 };
 
+    /// @brief A file to be added by @c add(std::span, unsigned).
+    struct source_file {
+        /// @brief The path to the file.
+        std::filesystem::path source;
+        /// @brief The name of the container file.
+        std::filesystem::path local;
+        /// @brief Additional manifest properties.
+        std::u8string properties = {};
+    };
+
     container() : container(options::none) {}
     container(options opts);
 
@@ -100,6 +128,21 @@ class container {
         return add(path, path.filename());
     }
 
+    /// @brief Add several files to the container.
+    ///
+    /// Equivalent to calling @c add for each file in turn, except
+    /// that the documents are parsed for metadata in parallel.  The
+    /// files are added to the manifest in the order given regardless
+    /// of the number of jobs.  If any file cannot be added, none are.
+    ///
+    /// @param files the files to add
+    /// @param jobs the number of documents to parse in parallel; zero
+    ///   selects one per hardware thread
+    /// @throws duplicate_error if a local name is already in use or
+    ///   appears twice in @p files
+    ///
+    void add(std::span<const source_file> files, unsigned jobs = 1);
+
     /// @brief The package document.
     auto &package() {
         return _package;
@@ -133,13 +176,40 @@ class container {
         _toc_stylesheet = std::move(path);
     }
 
+    /// @brief The record of previous builds used to skip unchanged
+    /// work.
+    ///
+    /// Must be set before files are added, so that metadata can be
+    /// reused rather than parsed again.  When writing with
+    /// @c output_options::incremental, unchanged files are kept from
+    /// the previous build instead of being copied or compressed.
+    ///
+    /// @param cache the cache, or a null pointer for none
+    ///
+    void cache(std::shared_ptr<build_cache> cache) {
+        _cache = std::move(cache);
+    }
+
     /// @brief Write the EPUB container to the given path.
     ///
-    /// The full prefix of @c path must exist.
+    /// The full prefix of @c path must exist.  If a cache is set, it
+    /// is saved once the container has been written.
+    ///
+    /// @param path the name of the destination directory or archive
+    /// @param options the format of the container
+    ///
+    void write(const std::filesystem::path &path,
+               const output_options &options = {}) const;
+
+    /// @brief Write the EPUB container to an open output.
+    ///
+    /// Writes the container, package, and navigation documents
+    /// followed by the files that were added.  The output is left
+    /// open so that the caller can add further content.
     ///
-    /// @param path the name of the destination directory
+    /// @param out the destination
     ///
-    void write(const std::filesystem::path &path) const;
+    void write(output &out) const;
 };
 
 static inline container::options operator~(const container::options &a) {
@@ -0,0 +1,200 @@
+#include "copy_file.hpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#endif
+
+#include <cerrno>
+#include <ostream>
+#include <system_error>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace epub {
+
+namespace {
+
+class descriptor {
+    int _fd;
+
+  public:
+    explicit descriptor(int fd)
+        : _fd(fd) {}
+
+    descriptor(const descriptor &) = delete;
+    descriptor &operator=(const descriptor &) = delete;
+
+    ~descriptor() {
+        if (_fd >= 0) ::close(_fd);
+    }
+
+    operator int() const {
+        return _fd;
+    }
+};
+
+[[noreturn]] void fail(const char *what, const fs::path &from,
+                       const fs::path &to, int error = errno) {
+    throw fs::filesystem_error(what, from, to,
+                               std::error_code{error, std::generic_category()});
+}
+
+#ifdef __linux__
+
+/// True if @p error means the mechanism cannot be used for this pair of
+/// files, as opposed to the copy itself having failed.
+bool unsupported(int error) {
+    switch (error) {
+        case ENOSYS:
+        case EXDEV:
+        case EINVAL:
+        case ENOTTY:
+        case EOPNOTSUPP:
+#if EOPNOTSUPP != ENOTSUP
+        case ENOTSUP:
+#endif
+            return true;
+        default:
+            return false;
+    }
+}
+
+/// Transfer @p size bytes with @p step, which behaves like
+/// @c copy_file_range or @c sendfile.  Returns false if the mechanism
+/// is unsupported and nothing was transferred.
+template <class Step>
+bool kernel_copy(Step step, off_t size, const fs::path &from,
+                 const fs::path &to) {
+    off_t copied = 0;
+
+    while (copied < size) {
+        auto n = step(static_cast<std::size_t>(size - copied));
+
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (copied == 0 && unsupported(errno)) return false;
+            fail("copy_file", from, to);
+        }
+
+        // The file is shorter than its reported size.
+        if (n == 0) {
+            if (copied == 0) return false;
+            fail("copy_file", from, to, EIO);
+        }
+
+        copied += n;
+    }
+
+    return true;
+}
+
+#endif
+
+void buffered_copy(int in, int out, const fs::path &from,
+                   const fs::path &to) {
+    std::vector<char> buffer(128 * 1024);
+
+    for (;;) {
+        auto n = ::read(in, buffer.data(), buffer.size());
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            fail("copy_file", from, to);
+        }
+        if (n == 0) return;
+
+        for (auto p = buffer.data(); n > 0;) {
+            auto w = ::write(out, p, static_cast<std::size_t>(n));
+            if (w < 0) {
+                if (errno == EINTR) continue;
+                fail("copy_file", from, to);
+            }
+            p += w;
+            n -= w;
+        }
+    }
+}
+
+} // namespace
+
+std::ostream &operator<<(std::ostream &os, copy_method method) {
+    switch (method) {
+        case copy_method::reflink:
+            return os << "reflink";
+        case copy_method::copy_file_range:
+            return os << "copy_file_range";
+        case copy_method::sendfile:
+            return os << "sendfile";
+        case copy_method::buffered:
+            return os << "buffered";
+    }
+
+    return os << "unknown";
+}
+
+copy_method copy_contents(int in, int out, std::uintmax_t size,
+                          const fs::path &from, const fs::path &to) {
+#ifdef __linux__
+    // Some filesystems (procfs, FUSE) report zero for files whose size
+    // is not known in advance, so read those until the end instead.
+    if (size == 0) {
+        buffered_copy(in, out, from, to);
+        return copy_method::buffered;
+    }
+
+    if (::ioctl(out, FICLONE, in) == 0) return copy_method::reflink;
+
+    loff_t in_off = 0;
+    loff_t out_off = 0;
+
+    if (kernel_copy(
+            [&](std::size_t n) {
+                return ::copy_file_range(in, &in_off, out, &out_off, n, 0);
+            },
+            static_cast<off_t>(size), from, to)) {
+        return copy_method::copy_file_range;
+    }
+
+    off_t offset = 0;
+
+    if (kernel_copy(
+            [&](std::size_t n) { return ::sendfile(out, in, &offset, n); },
+            static_cast<off_t>(size), from, to)) {
+        return copy_method::sendfile;
+    }
+#else
+    (void)size;
+#endif
+
+    buffered_copy(in, out, from, to);
+    return copy_method::buffered;
+}
+
+copy_method copy_file(const fs::path &from, const fs::path &to) {
+    descriptor in{::open(from.c_str(), O_RDONLY | O_CLOEXEC)};
+    if (in < 0) fail("copy_file", from, to);
+
+    struct stat st;
+    if (::fstat(in, &st) < 0) fail("copy_file", from, to);
+
+    descriptor out{::open(to.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC,
+                          st.st_mode & 0777)};
+    if (out < 0) fail("copy_file", from, to);
+
+    try {
+        return copy_contents(in, out, static_cast<std::uintmax_t>(st.st_size),
+                             from, to);
+    }
+    catch (...) {
+        ::unlink(to.c_str());
+        throw;
+    }
+}
+
+} // namespace epub
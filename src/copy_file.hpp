@@ -0,0 +1,57 @@
+#ifndef _copy_file_hpp_
+#define _copy_file_hpp_
+
+#include <cstdint>
+#include <filesystem>
+#include <iosfwd>
+
+namespace epub {
+
+/// @brief The mechanism used to transfer a file's contents.
+enum class copy_method {
+    reflink,         ///< Shared extents (FICLONE); no data is copied.
+    copy_file_range, ///< In-kernel copy with @c copy_file_range(2).
+    sendfile,        ///< In-kernel copy with @c sendfile(2).
+    buffered,        ///< Read and write through a user-space buffer.
+};
+
+std::ostream &operator<<(std::ostream &os, copy_method method);
+
+/// @brief Copy a regular file as cheaply as the system allows.
+///
+/// Tries, in order, a reflink clone, @c copy_file_range, @c sendfile
+/// and a buffered copy, moving on whenever a mechanism is unsupported
+/// by the kernel or by the filesystems involved.  Only the buffered
+/// copy is available on systems other than Linux.
+///
+/// @param from the existing file
+/// @param to the file to create; it must not already exist
+/// @returns the mechanism that copied the data
+/// @throws std::filesystem::filesystem_error if the file cannot be
+///   copied by any mechanism
+///
+copy_method copy_file(const std::filesystem::path &from,
+                      const std::filesystem::path &to);
+
+/// @brief Copy the contents of one open file to another.
+///
+/// The mechanisms are tried as for @c copy_file.  Both descriptors
+/// must be positioned at the start of their files.
+///
+/// @param in a descriptor open for reading
+/// @param out a descriptor open for writing
+/// @param size the size of the file open as @p in; if zero, the file
+///   is read until the end in case its size is not known in advance
+/// @param from the name of the file open as @p in, for errors
+/// @param to the name of the file open as @p out, for errors
+/// @returns the mechanism that copied the data
+/// @throws std::filesystem::filesystem_error if the data cannot be
+///   copied by any mechanism
+///
+copy_method copy_contents(int in, int out, std::uintmax_t size,
+                          const std::filesystem::path &from,
+                          const std::filesystem::path &to);
+
+} // namespace epub
+
+#endif
@@ -3,18 +3,27 @@
 
 #include "metadata.hpp"
 #include "options.hpp"
+#include "output.hpp"
 
+#include <algorithm>
+#include <charconv>
 #include <filesystem>
 #include <fstream>
 #include <iosfwd>
 #include <regex>
 #include <string>
+#include <system_error>
+#include <thread>
 
 namespace epub {
 
 struct configuration { // NOLINT
     std::filesystem::path output;
+    epub::output_format format = epub::output_format::expanded;
     bool overwrite = false;
+    unsigned jobs = 1;
+    bool io_uring = false;
+    epub::compression_policy compression;
     std::u8string title;
     std::u8string identifier;
     std::filesystem::path toc_stylesheet;
@@ -44,7 +53,9 @@ struct configuration { // NOLINT
 void common_options(cli::option_processor &opt,
                     std::shared_ptr<configuration> config) {
     opt.synopsis() +=
-        " [--output=filename] [--force] [--title=string]"
+        " [--output=filename] [--force] [--archive] [--jobs=N]"
+        " [--io-uring]"
+        " [--compression=level] [--title=string]"
         " [--creator=name [--file-as=sort-name] [--role=marc-code]]"
         " [--collection=group [--issue=num] [--set|--series]]"
         " [--identifier=urn] [--toc-stylesheet=path]"
@@ -63,6 +74,41 @@ void common_options(cli::option_processor &opt,
     opt.add_flag(
         'f', "force", [config] { config->overwrite = true; },
         "allow overwriting of the output file");
+    opt.add_flag(
+        "archive",
+        [config] { config->format = epub::output_format::packaged; },
+        "write a packaged EPUB archive rather than a directory");
+    opt.add_option(
+        'j', "jobs",
+        [config](const std::string &arg) {
+            unsigned jobs = 0;
+            auto last = arg.data() + arg.size();
+            auto [end, ec] = std::from_chars(arg.data(), last, jobs);
+            if (arg.empty() || ec != std::errc{} || end != last) {
+                throw cli::usage_error("jobs must be a non-negative number");
+            }
+
+            // Beyond a few workers per CPU, threads only contend.
+            auto limit = std::max(std::thread::hardware_concurrency(), 1U);
+            config->jobs = std::min(jobs, 4 * limit);
+        },
+        "number of files to process in parallel (0: one per CPU)");
+    opt.add_flag(
+        "io-uring", [config] { config->io_uring = true; },
+        "write output directories through io_uring where available");
+    opt.add_option(
+        "compression",
+        [config](const std::string &arg) {
+            int level = 0;
+            auto last = arg.data() + arg.size();
+            auto [end, ec] = std::from_chars(arg.data(), last, level);
+            if (arg.empty() || ec != std::errc{} || end != last ||
+                level < 0 || level > 9) {
+                throw cli::usage_error("compression level must be 0-9");
+            }
+            config->compression.level = level;
+        },
+        "compression level for text files in an archive (default: 4)");
     opt.add_option(
         'T', "title",
         [config](const std::string &arg) {
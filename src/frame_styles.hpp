@@ -0,0 +1,89 @@
+#ifndef _frame_styles_hpp_
+#define _frame_styles_hpp_
+
+#include "geom.hpp"
+
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace epub::comic {
+
+/// @brief The inline style placing an image in a frame.
+///
+/// @param frame the position and size of an image on its page
+/// @returns the value of the image's @c style attribute
+///
+inline std::u8string inline_style(const geom::rect &frame) {
+    using namespace std::literals;
+
+    auto css = "position: absolute; top: "s + std::to_string(frame.y) +
+               "px; left: "s + std::to_string(frame.x) + "px; width: "s +
+               std::to_string(frame.w) + "px; height: "s +
+               std::to_string(frame.h) + "px"s;
+
+    return {css.begin(), css.end()};
+}
+
+/// @brief Shared CSS classes for image frames.
+///
+/// Page layout produces few distinct frames, since strips from the
+/// same source usually share their sizes.  Rather than repeat the
+/// position of every image in an inline @c style attribute, each
+/// distinct frame is given a class in a single stylesheet shared by
+/// all pages.  Classes are numbered in the order frames are first
+/// seen, so the stylesheet is deterministic.
+///
+class frame_styles {
+    using key = std::tuple<std::size_t, std::size_t, std::size_t,
+                           std::size_t>;
+
+    std::map<key, std::size_t> _index;
+    std::vector<geom::rect> _frames;
+
+    static std::u8string name(std::size_t n) {
+        auto s = "f" + std::to_string(n);
+        return {s.begin(), s.end()};
+    }
+
+  public:
+    /// @brief The class for a frame.
+    ///
+    /// Adds a class if the frame has not been seen before.
+    ///
+    /// @param frame the position and size of an image on its page
+    /// @returns the name of the class
+    ///
+    std::u8string class_name(const geom::rect &frame) {
+        auto [found, added] = _index.try_emplace(
+            key{frame.x, frame.y, frame.w, frame.h}, _frames.size());
+        if (added) _frames.push_back(frame);
+        return name(found->second);
+    }
+
+    /// @brief The number of distinct frames.
+    auto size() const {
+        return _frames.size();
+    }
+
+    /// @brief The stylesheet defining every class.
+    std::string stylesheet() const {
+        std::string css = "img { position: absolute }\n";
+
+        for (std::size_t n = 0; n < _frames.size(); ++n) {
+            const auto &f = _frames[n];
+            css += "img.f" + std::to_string(n) +
+                   " { top: " + std::to_string(f.y) +
+                   "px; left: " + std::to_string(f.x) +
+                   "px; width: " + std::to_string(f.w) +
+                   "px; height: " + std::to_string(f.h) + "px }\n";
+        }
+
+        return css;
+    }
+};
+
+} // namespace epub::comic
+
+#endif
@@ -2,16 +2,24 @@
 #define _epub_geom_hpp_
 
 #include <cmath>
+#include <cstdint>
 #include <ostream>
 
 inline namespace geom {
 
+/// @brief A coordinate or length in pixels.
+///
+/// Thirty-two bits are ample for a page and keep a @c rect to 16
+/// bytes, which matters when a book has a million frames.
+///
+using coord = std::uint32_t;
+
 // clang-format off
 
 /// @brief A point in screen (left-to-right, top-to-bottom) coordinates.
 struct point {
-    std::size_t x;              ///< The x coordinate.
-    std::size_t y;              ///< The y coordinate.
+    coord x;                    ///< The x coordinate.
+    coord y;                    ///< The y coordinate.
 
     /// @brief Construct a point at the origin.
     point()
@@ -22,7 +30,7 @@ struct point {
     /// @param x the x coordinate
     /// @param y the y coordinate
     ///
-    point(std::size_t x, std::size_t y)
+    point(coord x, coord y)
         : x(x), y(y) {}
 
     /// @brief Equality comparison operator.
@@ -38,8 +46,8 @@ struct point {
 
 /// @brief A size of a rectangular area.
 struct size {
-    std::size_t w;              ///< The width of the area.
-    std::size_t h;              ///< The height of the area.
+    coord w;                    ///< The width of the area.
+    coord h;                    ///< The height of the area.
 
     /// @brief Construct an empty size.
     size()
@@ -49,7 +57,7 @@ struct size {
     ///
     /// @param width the width of the size
     /// @param height the height of the size
-    size(std::size_t width, std::size_t height)
+    size(coord width, coord height)
         : w(width), h(height) {}
 
     /// @brief Equality comparison operator.
@@ -147,7 +155,7 @@ struct rect : point, size {
     /// @param w the width of the rectangle
     /// @param h the height of the rectangle
     ///
-    rect(std::size_t x, std::size_t y, std::size_t w, std::size_t h)
+    rect(coord x, coord y, coord w, coord h)
         : point(x, y), size(w, h) {}
 
     /// @brief Copy constructor.
@@ -0,0 +1,170 @@
+#include "geom_batch.hpp"
+
+#include <cassert>
+#include <cstdint>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+inline namespace geom {
+
+namespace {
+
+using kernel = void (*)(coord *w, coord *h, std::size_t n,
+                        const size &bounds, bool grow_only);
+
+void fit_scalar(coord *w, coord *h, std::size_t n, const size &bounds,
+                bool grow_only) {
+    for (std::size_t i = 0; i < n; ++i) {
+        size sz{w[i], h[i]};
+        auto scale = sz.fit(bounds);
+
+        if (grow_only ? scale > 1.0 : scale != 1.0) {
+            sz *= scale;
+            w[i] = sz.w;
+            h[i] = sz.h;
+        }
+    }
+}
+
+#if defined(__x86_64__)
+
+// AVX2 converts only signed 32-bit integers, so unsigned values are
+// offset by 2^31 on the way in and out; both conversions are exact.
+
+__attribute__((target("avx2"))) inline __m256d load(const coord *p) {
+    auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    v = _mm_xor_si128(v, _mm_set1_epi32(INT32_MIN));
+    return _mm256_add_pd(_mm256_cvtepi32_pd(v),
+                         _mm256_set1_pd(2147483648.0));
+}
+
+__attribute__((target("avx2"))) inline void store(coord *p, __m256d x) {
+    auto v = _mm256_cvttpd_epi32(
+        _mm256_sub_pd(x, _mm256_set1_pd(2147483648.0)));
+    v = _mm_xor_si128(v, _mm_set1_epi32(INT32_MIN));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(p), v);
+}
+
+// std::round rounds halfway cases away from zero, which no AVX
+// rounding mode does; the fraction left by truncation is exact, so
+// comparing it with one half gives the same result.
+
+__attribute__((target("avx2"))) inline __m256d
+round_half_away(__m256d x) {
+    auto t = _mm256_round_pd(x, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+    auto up = _mm256_cmp_pd(_mm256_sub_pd(x, t), _mm256_set1_pd(0.5),
+                            _CMP_GE_OQ);
+    return _mm256_add_pd(t, _mm256_and_pd(up, _mm256_set1_pd(1.0)));
+}
+
+__attribute__((target("avx2"))) void
+fit_avx2(coord *w, coord *h, std::size_t n, const size &bounds,
+         bool grow_only) {
+    const auto bw = _mm256_set1_pd(static_cast<double>(bounds.w));
+    const auto bh = _mm256_set1_pd(static_cast<double>(bounds.h));
+    const auto one = _mm256_set1_pd(1.0);
+
+    std::size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        auto wd = load(w + i), hd = load(h + i);
+
+        // As std::min(sw, sh), which returns sw unless sh < sw.
+        auto scale = _mm256_min_pd(_mm256_div_pd(bh, hd),
+                                   _mm256_div_pd(bw, wd));
+
+        auto change = grow_only ? _mm256_cmp_pd(scale, one, _CMP_GT_OQ)
+                                : _mm256_cmp_pd(scale, one, _CMP_NEQ_UQ);
+
+        auto sw = round_half_away(_mm256_mul_pd(scale, wd));
+        auto sh = round_half_away(_mm256_mul_pd(scale, hd));
+
+        wd = _mm256_blendv_pd(wd, sw, change);
+        hd = _mm256_blendv_pd(hd, sh, change);
+
+        store(w + i, wd);
+        store(h + i, hd);
+    }
+
+    fit_scalar(w + i, h + i, n - i, bounds, grow_only);
+}
+
+#elif defined(__aarch64__)
+
+void fit_neon(coord *w, coord *h, std::size_t n, const size &bounds,
+              bool grow_only) {
+    const auto bw = vdupq_n_f64(static_cast<double>(bounds.w));
+    const auto bh = vdupq_n_f64(static_cast<double>(bounds.h));
+    const auto one = vdupq_n_f64(1.0);
+
+    std::size_t i = 0;
+
+    for (; i + 2 <= n; i += 2) {
+        auto wd = vcvtq_f64_u64(vmovl_u32(vld1_u32(w + i)));
+        auto hd = vcvtq_f64_u64(vmovl_u32(vld1_u32(h + i)));
+
+        auto sw = vdivq_f64(bw, wd), sh = vdivq_f64(bh, hd);
+        auto scale = vbslq_f64(vcltq_f64(sh, sw), sh, sw);
+
+        auto change = grow_only
+                          ? vcgtq_f64(scale, one)
+                          : veorq_u64(vceqq_f64(scale, one),
+                                      vdupq_n_u64(UINT64_MAX));
+
+        // vrndaq rounds halfway cases away from zero, as std::round.
+        wd = vbslq_f64(change, vrndaq_f64(vmulq_f64(scale, wd)), wd);
+        hd = vbslq_f64(change, vrndaq_f64(vmulq_f64(scale, hd)), hd);
+
+        vst1_u32(w + i, vmovn_u64(vcvtq_u64_f64(wd)));
+        vst1_u32(h + i, vmovn_u64(vcvtq_u64_f64(hd)));
+    }
+
+    fit_scalar(w + i, h + i, n - i, bounds, grow_only);
+}
+
+#endif
+
+struct implementation {
+    kernel fit;
+    const char *isa;
+};
+
+const implementation &select() {
+    static const implementation chosen = [] {
+#if defined(__x86_64__)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return implementation{fit_avx2, "avx2"};
+        }
+#elif defined(__aarch64__)
+        return implementation{fit_neon, "neon"};
+#endif
+        return implementation{fit_scalar, "scalar"};
+    }();
+
+    return chosen;
+}
+
+} // namespace
+
+void fit_sizes(std::span<coord> w, std::span<coord> h, const size &bounds,
+               bool grow_only) {
+    assert(w.size() == h.size());
+    select().fit(w.data(), h.data(), w.size(), bounds, grow_only);
+}
+
+void fit_sizes_scalar(std::span<coord> w, std::span<coord> h,
+                      const size &bounds, bool grow_only) {
+    assert(w.size() == h.size());
+    fit_scalar(w.data(), h.data(), w.size(), bounds, grow_only);
+}
+
+const char *fit_sizes_isa() {
+    return select().isa;
+}
+
+} // namespace geom
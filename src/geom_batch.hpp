@@ -0,0 +1,44 @@
+#ifndef _epub_geom_batch_hpp_
+#define _epub_geom_batch_hpp_
+
+#include "geom.hpp"
+
+#include <span>
+
+inline namespace geom {
+
+/// @brief Scale sizes to fit a bound, in bulk.
+///
+/// Each size (@p w[i], @p h[i]) is scaled as by
+///
+/// @code
+/// auto scale = sz.fit(bounds);
+/// if (grow_only ? scale > 1.0 : scale != 1.0) sz *= scale;
+/// @endcode
+///
+/// with identical results.  Where the processor supports it (AVX2 on
+/// x86-64, checked when first called, or NEON on AArch64), four or two
+/// sizes are scaled at a time.
+///
+/// @param w the widths
+/// @param h the heights, as many as the widths
+/// @param bounds the size to fit
+/// @param grow_only if true, sizes are only ever enlarged
+///
+void fit_sizes(std::span<coord> w, std::span<coord> h, const size &bounds,
+               bool grow_only = false);
+
+/// @brief Scale sizes to fit a bound, one at a time.
+///
+/// The reference for @c fit_sizes, with the same arguments.
+///
+void fit_sizes_scalar(std::span<coord> w, std::span<coord> h,
+                      const size &bounds, bool grow_only = false);
+
+/// @brief The instruction set used by @c fit_sizes on this processor:
+/// "avx2", "neon" or "scalar".
+const char *fit_sizes_isa();
+
+} // namespace geom
+
+#endif
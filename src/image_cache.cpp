@@ -0,0 +1,235 @@
+#include "image_cache.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+
+namespace fs = std::filesystem;
+
+namespace epub::comic {
+
+namespace {
+
+// The file is a header line followed by variable-length records, all
+// integers little-endian:
+//
+//     u16 path length, path
+//     u64 size, i64 mtime, u64 inode
+//     u32 width, u32 height
+//     u8 media type length, media type
+//     u8 extension length, extension
+
+constexpr std::string_view cache_header = "epubutil-images 1\n";
+
+template <class T>
+void put(std::string &buf, T v) {
+    for (std::size_t i = 0; i < sizeof(T); ++i) {
+        buf += static_cast<char>(static_cast<std::uint64_t>(v) >> (8 * i));
+    }
+}
+
+void put_string(std::string &buf, std::string_view s, std::size_t max) {
+    if (s.size() > max) throw std::length_error{"image cache field"};
+    if (max > 0xff) {
+        put(buf, static_cast<std::uint16_t>(s.size()));
+    }
+    else {
+        put(buf, static_cast<std::uint8_t>(s.size()));
+    }
+    buf += s;
+}
+
+/// Reads records from a mapped file, throwing if one is truncated.
+class parser {
+    std::string_view _data;
+
+    std::string_view take(std::size_t n) {
+        if (n > _data.size()) throw std::out_of_range{"image cache"};
+        auto s = _data.substr(0, n);
+        _data.remove_prefix(n);
+        return s;
+    }
+
+  public:
+    explicit parser(std::string_view data)
+        : _data(data) {}
+
+    bool done() const {
+        return _data.empty();
+    }
+
+    template <class T>
+    T get() {
+        std::uint64_t v = 0;
+        auto bytes = take(sizeof(T));
+        for (std::size_t i = 0; i < sizeof(T); ++i) {
+            v |= std::uint64_t{static_cast<unsigned char>(bytes[i])} << (8 * i);
+        }
+        return static_cast<T>(v);
+    }
+
+    std::string_view get_string(std::size_t max) {
+        return take(max > 0xff ? get<std::uint16_t>() : get<std::uint8_t>());
+    }
+};
+
+/// A read-only mapping of a whole file.
+class mapping {
+    void *_addr = MAP_FAILED;
+    std::size_t _size = 0;
+
+  public:
+    explicit mapping(const fs::path &path) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return;
+
+        struct stat st;
+        if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+            _size = static_cast<std::size_t>(st.st_size);
+            _addr = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+
+        ::close(fd);
+    }
+
+    mapping(const mapping &) = delete;
+    mapping &operator=(const mapping &) = delete;
+
+    ~mapping() {
+        if (_addr != MAP_FAILED) ::munmap(_addr, _size);
+    }
+
+    std::string_view data() const {
+        if (_addr == MAP_FAILED) return {};
+        return {static_cast<const char *>(_addr), _size};
+    }
+};
+
+std::string key_of(const fs::path &path) {
+    return fs::absolute(path).lexically_normal().string();
+}
+
+} // namespace
+
+image_cache::image_cache(fs::path path)
+    : _path(std::move(path)) {
+    mapping map{_path};
+    auto data = map.data();
+
+    if (!data.starts_with(cache_header)) return;
+
+    try {
+        parser p{data.substr(cache_header.size())};
+
+        while (!p.done()) {
+            std::string key{p.get_string(0xffff)};
+
+            struct stamp stamp;
+            stamp.size = p.get<std::uint64_t>();
+            stamp.mtime = p.get<std::int64_t>();
+            stamp.inode = p.get<std::uint64_t>();
+
+            auto w = p.get<std::uint32_t>();
+            auto h = p.get<std::uint32_t>();
+
+            auto media_type = p.get_string(0xff);
+            auto extension = p.get_string(0xff);
+
+            _previous.insert_or_assign(
+                std::move(key),
+                entry{stamp,
+                      image_info{{media_type.begin(), media_type.end()},
+                                 fs::path{extension},
+                                 geom::size{w, h}}});
+        }
+    }
+    catch (const std::out_of_range &) {
+        // A damaged cache only costs probing the images again.
+        _previous.clear();
+    }
+}
+
+auto image_cache::stamp_of(const fs::path &path) -> std::optional<stamp> {
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0) return std::nullopt;
+
+    std::int64_t mtime = static_cast<std::int64_t>(st.st_mtime) * 1000000000;
+#if defined(__APPLE__)
+    mtime += st.st_mtimespec.tv_nsec;
+#else
+    mtime += st.st_mtim.tv_nsec;
+#endif
+
+    return stamp{
+        .size = static_cast<std::uint64_t>(st.st_size),
+        .mtime = mtime,
+        .inode = static_cast<std::uint64_t>(st.st_ino),
+    };
+}
+
+std::optional<image_info> image_cache::find(const fs::path &path) const {
+    auto found = _previous.find(key_of(path));
+    if (found == _previous.end()) return std::nullopt;
+
+    auto stamp = stamp_of(path);
+    if (!stamp || *stamp != found->second.stamp) return std::nullopt;
+
+    return found->second.info;
+}
+
+void image_cache::insert(const fs::path &path, const image_info &info) {
+    auto stamp = stamp_of(path);
+    if (!stamp) return;
+
+    auto key = key_of(path);
+
+    std::lock_guard lock{_mutex};
+    _current.insert_or_assign(std::move(key), entry{*stamp, info});
+}
+
+void image_cache::save() const {
+    std::string buf{cache_header};
+
+    auto write = [&buf](const std::string &key, const entry &e) {
+        auto media_type = std::string_view{
+            reinterpret_cast<const char *>(e.info.media_type.data()),
+            e.info.media_type.size()};
+
+        put_string(buf, key, 0xffff);
+        put(buf, e.stamp.size);
+        put(buf, e.stamp.mtime);
+        put(buf, e.stamp.inode);
+        put(buf, static_cast<std::uint32_t>(e.info.size.w));
+        put(buf, static_cast<std::uint32_t>(e.info.size.h));
+        put_string(buf, media_type, 0xff);
+        put_string(buf, e.info.extension.string(), 0xff);
+    };
+
+    for (auto &&[key, e] : _previous) {
+        if (!_current.contains(key)) write(key, e);
+    }
+    for (auto &&[key, e] : _current) write(key, e);
+
+    auto temporary = _path;
+    temporary += ".tmp";
+
+    {
+        std::ofstream out{temporary, std::ios::binary};
+        out.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+
+        if (!out.flush()) {
+            throw fs::filesystem_error("unable to write", temporary,
+                                       std::io_errc::stream);
+        }
+    }
+
+    fs::rename(temporary, _path);
+}
+
+} // namespace epub::comic
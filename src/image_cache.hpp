@@ -0,0 +1,97 @@
+#ifndef _epub_image_cache_hpp_
+#define _epub_image_cache_hpp_
+
+#include "image_ref.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace epub::comic {
+
+/// @brief A persistent record of image headers.
+///
+/// Probing an image means opening and reading the start of the file,
+/// which is slow for large collections on network storage.  The cache
+/// keeps the media type, extension and dimensions of each image in a
+/// compact binary file that is mapped into memory in one piece when it
+/// is loaded.
+///
+/// An entry is used only if the size, modification time and inode
+/// number of the file are unchanged, so a lookup costs a single
+/// @c stat call.  Lookups and insertions may be made from several
+/// threads.
+///
+class image_cache {
+  public:
+    /// @brief The identity of a file at the time it was probed.
+    struct stamp {
+        std::uint64_t size = 0;
+        std::int64_t mtime = 0;
+        std::uint64_t inode = 0;
+
+        bool operator==(const stamp &) const = default;
+    };
+
+  private:
+    struct entry {
+        struct stamp stamp;
+        image_info info;
+    };
+
+    std::filesystem::path _path;
+    std::unordered_map<std::string, entry> _previous;
+
+    std::mutex _mutex;
+    std::unordered_map<std::string, entry> _current;
+
+  public:
+    /// @brief Load the cache from @p path.
+    ///
+    /// A missing or damaged cache file is treated as empty.
+    ///
+    /// @param path the cache file
+    ///
+    explicit image_cache(std::filesystem::path path);
+
+    /// @brief The current identity of a file.
+    ///
+    /// @param path the file
+    /// @returns the stamp, or an empty optional if the file cannot be
+    ///   examined
+    ///
+    static std::optional<stamp> stamp_of(const std::filesystem::path &path);
+
+    /// @brief Look up an image.
+    ///
+    /// @param path the image file
+    /// @returns the recorded information, or an empty optional if there
+    ///   is none or the file has changed
+    ///
+    std::optional<image_info> find(const std::filesystem::path &path) const;
+
+    /// @brief Record the information probed from an image.
+    ///
+    /// @param path the image file
+    /// @param info the information
+    ///
+    void insert(const std::filesystem::path &path, const image_info &info);
+
+    /// @brief Write the cache.
+    ///
+    /// Entries recorded during this run replace those loaded; other
+    /// loaded entries are kept, so that one cache can serve runs over
+    /// different parts of a collection.
+    ///
+    /// @throws std::filesystem::filesystem_error if the file cannot be
+    ///   written
+    ///
+    void save() const;
+};
+
+} // namespace epub::comic
+
+#endif
@@ -9,7 +9,13 @@
 
 #include "image_ref.hpp"
 
+#include "frame_styles.hpp"
+#include "image_cache.hpp"
+#include "mapped_reader.hpp"
+#include "worker_pool.hpp"
+
 #include <filesystem>
+#include <future>
 #include <stdexcept>
 
 static inline std::string to_digits(unsigned n, unsigned d) {
@@ -26,7 +32,7 @@ static inline std::string to_digits(unsigned n, unsigned d) {
 namespace epub::comic {
 
 image_info::image_info(const std::filesystem::path &path) {
-    auto info = imageinfo::parse<imageinfo::FilePathReader>(path);
+    auto info = imageinfo::parse<mapped_reader>(path);
 
     if (!info) throw std::runtime_error{"cannot read image file"};
 
@@ -37,6 +43,40 @@ image_info::image_info(const std::filesystem::path &path) {
     size = geom::size(sz.width, sz.height);
 }
 
+static image_info probe_one(const std::string &path, image_cache *cache) {
+    if (!cache) return image_info{path};
+
+    if (auto found = cache->find(path)) return std::move(*found);
+
+    image_info info{path};
+    cache->insert(path, info);
+    return info;
+}
+
+std::vector<image_info> probe_images(std::span<const std::string> paths,
+                                     unsigned jobs, image_cache *cache) {
+    std::vector<image_info> result;
+    result.reserve(paths.size());
+
+    if (jobs == 1 || paths.size() < 2) {
+        for (auto &&path : paths) result.push_back(probe_one(path, cache));
+        return result;
+    }
+
+    worker_pool pool{jobs};
+    std::vector<std::future<image_info>> probes;
+    probes.reserve(paths.size());
+
+    for (auto &&path : paths) {
+        probes.push_back(
+            pool.submit([&path, cache] { return probe_one(path, cache); }));
+    }
+
+    for (auto &&probe : probes) result.push_back(probe.get());
+
+    return result;
+}
+
 image_ref::image_ref(const std::filesystem::path &path,
                      const std::filesystem::path &local, image_info info)
     : path(path)
@@ -53,15 +93,12 @@ image_ref::image_ref(const std::filesystem::path &path,
 image_ref::image_ref(const std::filesystem::path &path, unsigned num)
     : image_ref(std::move(path), "im" + to_digits(num, 5)) {}
 
-std::u8string image_ref::style() const {
-    using namespace std::literals;
-
-    auto css = "position: absolute; top: "s + std::to_string(frame.y) +
-               "px; left: "s + std::to_string(frame.x) + "px; width: "s +
-               std::to_string(frame.w) + "px; height: "s +
-               std::to_string(frame.h) + "px"s;
+image_ref::image_ref(const std::filesystem::path &path, unsigned num,
+                     image_info info)
+    : image_ref(path, "im" + to_digits(num, 5), std::move(info)) {}
 
-    return std::u8string{reinterpret_cast<const char8_t *>(css.c_str())};
+std::u8string image_ref::style() const {
+    return inline_style(frame);
 }
 
 } // namespace epub::comic
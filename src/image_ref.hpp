@@ -5,6 +5,9 @@
 
 #include <filesystem>
 #include <ranges>
+#include <span>
+#include <string>
+#include <vector>
 
 namespace epub::comic {
 
@@ -14,8 +17,35 @@ struct image_info {
     geom::size size;
 
     explicit image_info(const std::filesystem::path &path);
+
+    image_info(std::u8string media_type, std::filesystem::path extension,
+               geom::size size)
+        : media_type(std::move(media_type))
+        , extension(std::move(extension))
+        , size(size) {}
 };
 
+class image_cache;
+
+/// @brief Read the headers of several images.
+///
+/// The files are opened and read concurrently, which hides the
+/// latency of slow (e.g., network) storage.  The results are in the
+/// same order as @p paths regardless of the number of jobs.
+///
+/// @param paths the image files
+/// @param jobs the number of files to read at once; zero selects one
+///   per hardware thread
+/// @param cache a cache consulted before reading each file and
+///   updated with what is read, or a null pointer for none
+/// @returns the information for each image
+/// @throws std::runtime_error for the first image, in order, that
+///   cannot be read
+///
+std::vector<image_info> probe_images(std::span<const std::string> paths,
+                                     unsigned jobs,
+                                     image_cache *cache = nullptr);
+
 struct image_ref {
     std::filesystem::path path;
     std::filesystem::path local;
@@ -30,6 +60,8 @@ struct image_ref {
     image_ref(const std::filesystem::path &path,
               const std::filesystem::path &local);
     image_ref(const std::filesystem::path &path, unsigned num);
+    image_ref(const std::filesystem::path &path, unsigned num,
+              image_info info);
 
     std::u8string style() const;
 
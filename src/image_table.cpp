@@ -0,0 +1,88 @@
+#include "image_table.hpp"
+
+#include "geom_batch.hpp"
+
+#include <algorithm>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+
+static inline std::string to_digits(unsigned n, unsigned d) {
+    std::string str(d, '0');
+
+    for (char &c : str | std::views::reverse) {
+        c = static_cast<char>('0' + n % 10);
+        n /= 10;
+    }
+
+    return str;
+}
+
+namespace epub::comic {
+
+std::size_t image_table::add(std::string_view path, const image_info &info) {
+    auto extension = info.extension.string();
+
+    auto found = std::ranges::find_if(_media, [&](auto &&m) {
+        return m.type == info.media_type && m.extension == extension;
+    });
+
+    if (found == _media.end()) {
+        if (_media.size() > UINT8_MAX) {
+            throw std::length_error{"image_table: too many media types"};
+        }
+        found = _media.insert(_media.end(),
+                              {info.media_type, std::move(extension)});
+    }
+
+    _type.push_back(static_cast<std::uint8_t>(found - _media.begin()));
+
+    _paths += path;
+    _path_end.push_back(_paths.size());
+
+    _source_w.push_back(info.size.w);
+    _source_h.push_back(info.size.h);
+
+    x.push_back(0);
+    y.push_back(0);
+    w.push_back(info.size.w);
+    h.push_back(info.size.h);
+
+    return size() - 1;
+}
+
+std::filesystem::path image_table::local(std::size_t i) const {
+    return "im" + to_digits(number(i), 5) + _media[_type[i]].extension;
+}
+
+void image_table::fit(std::size_t first, std::size_t last,
+                      const geom::size &bounds, bool grow_only) {
+    fit_sizes(std::span{w}.subspan(first, last - first),
+              std::span{h}.subspan(first, last - first), bounds, grow_only);
+}
+
+void image_table::erase_front(std::size_t n) {
+    if (n == 0) return;
+
+    auto erase = [n](auto &column) {
+        column.erase(column.begin(),
+                     column.begin() + static_cast<std::ptrdiff_t>(n));
+    };
+
+    auto removed = _path_end[n - 1];
+    _paths.erase(0, removed);
+    erase(_path_end);
+    for (auto &end : _path_end) end -= removed;
+
+    erase(_type);
+    erase(_source_w);
+    erase(_source_h);
+    erase(x);
+    erase(y);
+    erase(w);
+    erase(h);
+
+    _first_number += static_cast<unsigned>(n);
+}
+
+} // namespace epub::comic
@@ -0,0 +1,119 @@
+#ifndef _image_table_hpp_
+#define _image_table_hpp_
+
+#include "geom.hpp"
+#include "image_ref.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace epub::comic {
+
+/// @brief The images of a book, stored by column.
+///
+/// Rather than an @c image_ref per image, with its two paths and media
+/// type string, each attribute is kept in an array of its own: the
+/// frames as four arrays of 32-bit coordinates, the media type as an
+/// index into a small table of the types seen, and the source paths
+/// concatenated in a single string.  An image then costs 33 bytes
+/// besides its path, and scaling runs over contiguous arrays.
+///
+/// Images are numbered from one in the order they are added.  The
+/// number names the copy of the image in the publication and is kept
+/// when earlier images are removed.
+///
+class image_table {
+    struct media {
+        std::u8string type;
+        std::string extension;
+    };
+
+    std::vector<media> _media;
+    std::vector<std::uint8_t> _type;
+    std::string _paths;
+    std::vector<std::size_t> _path_end;
+    std::vector<geom::coord> _source_w, _source_h;
+    unsigned _first_number = 1;
+
+  public:
+    /// @name Frames
+    /// The position and size of each image on its page.
+    /// @{
+    std::vector<geom::coord> x, y, w, h;
+    /// @}
+
+    /// @brief The number of images.
+    std::size_t size() const {
+        return _type.size();
+    }
+
+    /// @brief Add an image.
+    ///
+    /// The frame is set to the size of the image, at the origin.
+    ///
+    /// @param path the source file
+    /// @param info the type and size of the image
+    /// @returns the index of the image
+    /// @throws std::length_error if the image has a 257th media type
+    ///
+    std::size_t add(std::string_view path, const image_info &info);
+
+    /// @brief The source file of an image.
+    std::string_view path(std::size_t i) const {
+        return std::string_view{_paths}.substr(
+            i == 0 ? 0 : _path_end[i - 1],
+            _path_end[i] - (i == 0 ? 0 : _path_end[i - 1]));
+    }
+
+    /// @brief The media type of an image.
+    std::u8string_view media_type(std::size_t i) const {
+        return _media[_type[i]].type;
+    }
+
+    /// @brief The number of an image.
+    unsigned number(std::size_t i) const {
+        return _first_number + static_cast<unsigned>(i);
+    }
+
+    /// @brief The path of the copy of an image in the publication.
+    std::filesystem::path local(std::size_t i) const;
+
+    /// @brief The frame of an image.
+    geom::rect frame(std::size_t i) const {
+        return {x[i], y[i], w[i], h[i]};
+    }
+
+    /// @brief The size of an image as read, before any scaling.
+    geom::size source_size(std::size_t i) const {
+        return {_source_w[i], _source_h[i]};
+    }
+
+    /// @brief Scale images to fit a size.
+    ///
+    /// Each image in the range is scaled by the largest factor that
+    /// fits it within @p bounds, as by @c geom::size::fit.  The range
+    /// is scaled in one pass by @c geom::fit_sizes.
+    ///
+    /// @param first the index of the first image
+    /// @param last the index past the last image
+    /// @param bounds the size to fit
+    /// @param grow_only if true, images are only ever enlarged
+    ///
+    void fit(std::size_t first, std::size_t last, const geom::size &bounds,
+             bool grow_only = false);
+
+    /// @brief Remove the first images.
+    ///
+    /// The remaining images keep their numbers.
+    ///
+    /// @param n the number of images to remove
+    ///
+    void erase_front(std::size_t n);
+};
+
+} // namespace epub::comic
+
+#endif
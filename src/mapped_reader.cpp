@@ -0,0 +1,75 @@
+#include "mapped_reader.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace epub::comic {
+
+mapped_reader::mapped_reader(const std::filesystem::path &path) {
+    _fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (_fd < 0) return;
+
+    struct stat st;
+    if (::fstat(_fd, &st) != 0 || st.st_size <= 0) return;
+
+    _size = static_cast<std::size_t>(st.st_size);
+
+    if (_size <= small_file) {
+        _buffer.resize(_size);
+        auto n = ::pread(_fd, _buffer.data(), _size, 0);
+        _buffer.resize(n < 0 ? 0 : static_cast<std::size_t>(n));
+        _size = _buffer.size();
+        return;
+    }
+
+#ifdef POSIX_FADV_SEQUENTIAL
+    ::posix_fadvise(_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    auto map = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, _fd, 0);
+    if (map == MAP_FAILED) return;
+
+    _map = map;
+    ::madvise(_map, _size, MADV_SEQUENTIAL);
+}
+
+mapped_reader::~mapped_reader() {
+    if (_map) ::munmap(_map, _size);
+    if (_fd >= 0) ::close(_fd);
+}
+
+void mapped_reader::read(void *buf, off_t offset, std::size_t size) {
+    auto out = static_cast<char *>(buf);
+    std::size_t copied = 0;
+
+    if (offset >= 0 && static_cast<std::size_t>(offset) < _size) {
+        auto start = static_cast<std::size_t>(offset);
+        auto n = std::min(size, _size - start);
+
+        if (_map) {
+            std::memcpy(out, static_cast<const char *>(_map) + start, n);
+            copied = n;
+        }
+        else if (!_buffer.empty()) {
+            std::memcpy(out, _buffer.data() + start, n);
+            copied = n;
+        }
+        else {
+            while (copied < n) {
+                auto r = ::pread(_fd, out + copied, n - copied,
+                                 offset + static_cast<off_t>(copied));
+                if (r <= 0) break;
+                copied += static_cast<std::size_t>(r);
+            }
+        }
+    }
+
+    std::memset(out + copied, 0, size - copied);
+}
+
+} // namespace epub::comic
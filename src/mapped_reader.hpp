@@ -0,0 +1,60 @@
+#ifndef _epub_mapped_reader_hpp_
+#define _epub_mapped_reader_hpp_
+
+#include <sys/types.h>
+
+#include <cstddef>
+#include <filesystem>
+#include <string>
+
+namespace epub::comic {
+
+/// @brief A reader for @c imageinfo::parse backed by memory mapping.
+///
+/// @c imageinfo::FilePathReader seeks and reads through a stream for
+/// every field it examines, which adds up for formats such as JPEG
+/// whose dimensions may follow a large EXIF block.  This reader reads
+/// a small file with a single @c pread, and maps a larger one so that
+/// each read is a copy from memory.  The kernel is told that access
+/// will be sequential so that it reads ahead.  If the file cannot be
+/// mapped, each read falls back to @c pread.
+///
+/// A file that cannot be opened has size zero, which @c imageinfo
+/// reports as an unrecognized image.
+///
+class mapped_reader {
+    int _fd = -1;
+    std::size_t _size = 0;
+    void *_map = nullptr;
+    std::string _buffer;
+
+  public:
+    /// @brief Files up to this size are read whole.
+    static constexpr std::size_t small_file = 64 * 1024;
+
+    explicit mapped_reader(const std::filesystem::path &path);
+
+    mapped_reader(const mapped_reader &) = delete;
+    mapped_reader &operator=(const mapped_reader &) = delete;
+
+    ~mapped_reader();
+
+    /// @brief The size of the file.
+    std::size_t size() const {
+        return _size;
+    }
+
+    /// @brief Copy part of the file.
+    ///
+    /// Bytes beyond the end of the file are set to zero.
+    ///
+    /// @param buf the destination
+    /// @param offset the position of the first byte to copy
+    /// @param size the number of bytes to copy
+    ///
+    void read(void *buf, off_t offset, std::size_t size);
+};
+
+} // namespace epub::comic
+
+#endif
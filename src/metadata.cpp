@@ -1,5 +1,6 @@
 #include "metadata.hpp"
 
+#include <cstdlib>
 #include <iomanip>
 #include <random>
 #include <sstream>
@@ -33,6 +34,18 @@ std::u8string generate_uuid() {
     return uuid;
 }
 
+std::chrono::system_clock::time_point timestamp() {
+    using namespace std::chrono;
+
+    if (auto epoch = std::getenv("SOURCE_DATE_EPOCH"); epoch && *epoch) {
+        char *end = nullptr;
+        auto secs = std::strtoll(epoch, &end, 10);
+        if (*end == '\0') return system_clock::time_point{seconds{secs}};
+    }
+
+    return system_clock::now();
+}
+
 std::u8string generate_id() {
     static unsigned next = 0U;
 
@@ -21,6 +21,16 @@ namespace epub {
 ///
 extern std::u8string generate_uuid();
 
+/// @brief The modification time of the publication.
+///
+/// Returns the current time unless the @c SOURCE_DATE_EPOCH
+/// environment variable holds a number of seconds since the epoch,
+/// in which case that time is used so that builds are reproducible.
+///
+/// @returns the time to record in timestamps
+///
+extern std::chrono::system_clock::time_point timestamp();
+
 /// @brief Generate a XML ID.
 ///
 /// Generates a sequential identifier that can be used as an XML ID.
@@ -2,11 +2,13 @@
 
 #include <libxml/parser.h>
 #include <libxml/tree.h>
+#include <libxml/xmlreader.h>
 #include <libxml/xpath.h>
 #include <libxml/xpathInternals.h>
 
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <span>
 #include <stdexcept>
 #include <string>
@@ -26,6 +28,13 @@ struct ns : xmlNs {
     static constexpr auto deleter = &xmlFreeNs;
 };
 
+// libxml2 must be initialized once before documents are parsed on
+// several threads; each parse then uses its own parser context.
+static void init_parser() {
+    static std::once_flag once;
+    std::call_once(once, xmlInitParser);
+}
+
 template <class T>
 std::shared_ptr<T> managed(void *ptr) {
     return std::shared_ptr<T>(static_cast<T *>(ptr), T::deleter);
@@ -130,8 +139,64 @@ node_ptr new_cdata_child(const node_ptr &node, const std::u8string &data) {
     return node_ptr{node, static_cast<struct node *>(ptr)};
 }
 
+node_ref new_root_element(const doc_ptr &doc, const std::u8string &name) {
+    auto n = BAD_CAST(name.c_str());
+
+    auto ptr = xmlNewDocRawNode(doc.get(), nullptr, n, nullptr);
+    if (xmlDocSetRootElement(doc.get(), ptr)) {
+        throw std::runtime_error{__func__};
+    }
+
+    return node_ref{static_cast<node *>(ptr)};
+}
+
+ns_ref new_ns(node_ref element, const std::u8string &uri,
+              const std::optional<std::u8string> &prefix) {
+    auto u = BAD_CAST(uri.c_str());
+    auto p = BAD_CAST(prefix ? prefix->c_str() : nullptr);
+
+    return ns_ref{static_cast<ns *>(xmlNewNs(element.get(), u, p))};
+}
+
+void set_ns(node_ref element, ns_ref ns) {
+    xmlSetNs(element.get(), ns.get());
+}
+
+void set_attribute(node_ref node, const std::u8string &name,
+                   const std::u8string &value) {
+    auto n = BAD_CAST(name.c_str());
+    auto v = BAD_CAST(value.c_str());
+
+    xmlSetProp(node.get(), n, v);
+}
+
+void set_attribute(node_ref node, ns_ref ns, const std::u8string &name,
+                   const std::u8string &value) {
+    auto n = BAD_CAST(name.c_str());
+    auto v = BAD_CAST(value.c_str());
+
+    xmlSetNsProp(node.get(), ns.get(), n, v);
+}
+
+node_ref new_child_node(node_ref node, ns_ref ns, const std::u8string &name,
+                        const std::optional<std::u8string> &content) {
+    auto n = BAD_CAST(name.c_str());
+    auto c = BAD_CAST(content ? content->c_str() : nullptr);
+
+    auto ptr = xmlNewTextChild(node.get(), ns.get(), n, c);
+    return node_ref{static_cast<struct node *>(ptr)};
+}
+
+node_ref new_cdata_child(node_ref node, const std::u8string &data) {
+    std::span d{BAD_CAST(data.data()), data.size()};
+    auto ptr = xmlNewCDataBlock(node.get()->doc, d.data(), d.size()); // NOLINT
+    xmlAddChild(node.get(), ptr);
+    return node_ref{static_cast<struct node *>(ptr)};
+}
+
 doc_ptr read_file(const std::filesystem::path &path) {
     static constexpr auto options = XML_PARSE_NOENT;
+    init_parser();
     return managed<doc>(xmlReadFile(path.c_str(), nullptr, options));
 }
 
@@ -140,6 +205,19 @@ void save_file(const std::filesystem::path &path, const doc_ptr &doc,
     xmlSaveFormatFile(path.c_str(), doc.get(), format ? 1 : 0);
 }
 
+std::string save_string(const doc_ptr &doc, bool format) {
+    xmlChar *mem = nullptr;
+    int size = 0;
+
+    xmlDocDumpFormatMemory(doc.get(), &mem, &size, format ? 1 : 0);
+
+    std::unique_ptr<xmlChar, xml_free_deleter> guard{mem};
+    if (!mem) throw std::runtime_error{__func__};
+
+    return std::string{reinterpret_cast<const char *>(mem),
+                       static_cast<std::size_t>(size)};
+}
+
 namespace xpath {
 
 struct context : xmlXPathContext {
@@ -197,4 +275,79 @@ result eval(const std::u8string &expr, const context_ptr &ctx) {
 
 } // namespace xpath
 
+namespace reader {
+
+// xmlTextReader is opaque, so unlike the tree types it cannot be a base.
+struct text_reader {
+    static void deleter(text_reader *reader) {
+        xmlFreeTextReader(reinterpret_cast<xmlTextReaderPtr>(reader));
+    }
+};
+
+static inline xmlTextReaderPtr get(const reader_ptr &reader) {
+    return reinterpret_cast<xmlTextReaderPtr>(reader.get());
+}
+
+static inline std::u8string
+take_string(std::unique_ptr<xmlChar, xml_free_deleter> str) {
+    if (str) return reinterpret_cast<const char8_t *>(str.get());
+    return {};
+}
+
+reader_ptr open(const std::filesystem::path &path) {
+    static constexpr auto options = XML_PARSE_NOENT;
+    init_parser();
+    return managed<text_reader>(
+        xmlReaderForFile(path.c_str(), nullptr, options));
+}
+
+bool read(const reader_ptr &reader) {
+    return reader && xmlTextReaderRead(get(reader)) == 1;
+}
+
+node_type type(const reader_ptr &reader) {
+    switch (xmlTextReaderNodeType(get(reader))) {
+        case XML_READER_TYPE_ELEMENT:
+            return node_type::element;
+        case XML_READER_TYPE_END_ELEMENT:
+            return node_type::end_element;
+        default:
+            return node_type::other;
+    }
+}
+
+int depth(const reader_ptr &reader) {
+    return xmlTextReaderDepth(get(reader));
+}
+
+bool is_empty_element(const reader_ptr &reader) {
+    return xmlTextReaderIsEmptyElement(get(reader)) == 1;
+}
+
+std::u8string local_name(const reader_ptr &reader) {
+    auto name = xmlTextReaderConstLocalName(get(reader));
+    if (name) return reinterpret_cast<const char8_t *>(name);
+    return {};
+}
+
+std::u8string namespace_uri(const reader_ptr &reader) {
+    auto uri = xmlTextReaderConstNamespaceUri(get(reader));
+    if (uri) return reinterpret_cast<const char8_t *>(uri);
+    return {};
+}
+
+std::u8string get_attribute(const reader_ptr &reader,
+                            const std::u8string &name) {
+    auto n = BAD_CAST(name.c_str());
+    return take_string(std::unique_ptr<xmlChar, xml_free_deleter>{
+        xmlTextReaderGetAttribute(get(reader), n)});
+}
+
+std::u8string read_string(const reader_ptr &reader) {
+    return take_string(std::unique_ptr<xmlChar, xml_free_deleter>{
+        xmlTextReaderReadString(get(reader))});
+}
+
+} // namespace reader
+
 } // namespace epub::xml
@@ -1,6 +1,7 @@
 #ifndef _minidom_hpp_
 #define _minidom_hpp_
 
+#include <cstddef>
 #include <filesystem>
 #include <memory>
 #include <optional>
@@ -46,9 +47,55 @@ new_child_node(const node_ptr &node, const ns_ptr &ns,
 node_ptr new_cdata(const doc_ptr &doc, const std::u8string &data);
 node_ptr new_cdata_child(const node_ptr &node, const std::u8string &data);
 
+/// @brief A non-owning reference to a node or namespace.
+///
+/// Unlike @c node_ptr and @c ns_ptr, a handle holds no reference
+/// count; it is only valid while the @c doc_ptr that owns the document
+/// is alive.  Building a document through handles avoids a shared
+/// control block for every node created.
+///
+template <class T>
+class handle {
+    T *_ptr = nullptr;
+
+  public:
+    handle() = default;
+    handle(std::nullptr_t) {}
+    explicit handle(T *ptr) : _ptr(ptr) {}
+
+    T *get() const {
+        return _ptr;
+    }
+
+    explicit operator bool() const {
+        return _ptr != nullptr;
+    }
+};
+
+using node_ref = handle<struct node>;
+using ns_ref = handle<struct ns>;
+
+node_ref new_root_element(const doc_ptr &doc, const std::u8string &name);
+
+ns_ref new_ns(node_ref element, const std::u8string &uri,
+              const std::optional<std::u8string> &prefix = std::nullopt);
+void set_ns(node_ref element, ns_ref ns);
+
+void set_attribute(node_ref node, const std::u8string &name,
+                   const std::u8string &value);
+void set_attribute(node_ref node, ns_ref ns, const std::u8string &name,
+                   const std::u8string &value);
+
+node_ref
+new_child_node(node_ref node, ns_ref ns, const std::u8string &name,
+               const std::optional<std::u8string> &content = std::nullopt);
+
+node_ref new_cdata_child(node_ref node, const std::u8string &data);
+
 doc_ptr read_file(const std::filesystem::path &path);
 void save_file(const std::filesystem::path &path, const doc_ptr &doc,
                bool format);
+std::string save_string(const doc_ptr &doc, bool format);
 
 namespace xpath {
 
@@ -65,6 +112,36 @@ result eval(const std::u8string &expr, const context_ptr &ctx);
 
 } // namespace xpath
 
+/// @brief A forward-only reader over the nodes of a document.
+///
+/// Only the current node is held in memory, so a caller that stops
+/// reading early never parses the rest of the file.  Separate readers
+/// may be used concurrently on different threads.
+///
+namespace reader {
+
+using reader_ptr = std::shared_ptr<struct text_reader>;
+
+enum class node_type { element, end_element, other };
+
+reader_ptr open(const std::filesystem::path &path);
+
+bool read(const reader_ptr &reader);
+
+node_type type(const reader_ptr &reader);
+int depth(const reader_ptr &reader);
+bool is_empty_element(const reader_ptr &reader);
+
+std::u8string local_name(const reader_ptr &reader);
+std::u8string namespace_uri(const reader_ptr &reader);
+
+std::u8string get_attribute(const reader_ptr &reader,
+                            const std::u8string &name);
+
+std::u8string read_string(const reader_ptr &reader);
+
+} // namespace reader
+
 } // namespace epub::xml
 
 #endif
@@ -0,0 +1,352 @@
+#include "output.hpp"
+
+#include "copy_file.hpp"
+#include "logging.hpp"
+#include "uring.hpp"
+#include "worker_pool.hpp"
+#include "zip.hpp"
+
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <future>
+#include <iterator>
+#include <set>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace epub {
+
+static constexpr std::string_view epub_mimetype = "application/epub+zip";
+
+namespace {
+
+class expanded_output : public output {
+    fs::path _root;
+    fs::copy_options _copy_options;
+
+    /// Directories known to exist, so they are only created once.
+    std::set<fs::path> _directories;
+
+    /// Writes and copies not yet known to have finished.
+    std::deque<std::future<void>> _pending;
+    std::size_t _window = 0;
+
+    /// Submit files in batches through io_uring.
+    bool _uring;
+
+    /// Small files waiting to be written by a single task.
+    std::vector<uring::file_write> _batch;
+    std::size_t _batch_bytes = 0;
+
+    /// Copies waiting to be submitted through io_uring.
+    std::vector<uring::file_copy> _copies;
+
+    static constexpr std::size_t batch_files = 64;
+    static constexpr std::size_t batch_bytes = 256 * 1024;
+
+    std::unique_ptr<worker_pool> _pool;
+
+    /// Files of the previous build that have not been replaced or kept.
+    std::set<fs::path> _stale;
+
+    fs::path prepare(const fs::path &local) {
+        auto path = _root / local;
+        auto parent = path.parent_path();
+        if (_directories.insert(parent).second) create_directories(parent);
+        if (_stale.erase(local)) fs::remove(path);
+        return path;
+    }
+
+    static void materialize(const fs::path &source, const fs::path &path,
+                            fs::copy_options copy_options) {
+        // Links are only possible within a filesystem; otherwise fall
+        // back to copying the data.
+        if (copy_options != fs::copy_options::none) {
+            std::error_code ec;
+            fs::copy(source, path, copy_options, ec);
+            if (!ec) return;
+            if (ec != std::errc::cross_device_link) {
+                throw fs::filesystem_error("copy", source, path, ec);
+            }
+        }
+
+        auto method = epub::copy_file(source, path);
+        LOG(logging::DEBUG, "copied ", source, " using ", method);
+    }
+
+    static void save(const fs::path &path, std::string_view data) {
+        std::ofstream out{path, std::ios::binary};
+        auto size = static_cast<std::streamsize>(data.size());
+        if (!out.write(data.data(), size)) {
+            throw fs::filesystem_error("unable to write", path,
+                                       std::io_errc::stream);
+        }
+    }
+
+    /// Run @p fn on the pool, or at once if there is no pool.
+    template <class Fn>
+    void enqueue(Fn &&fn) {
+        if (!_pool) {
+            fn();
+            return;
+        }
+
+        _pending.push_back(_pool->submit(std::forward<Fn>(fn)));
+        while (_pending.size() > _window) wait_one();
+    }
+
+    void flush_batch() {
+        if (_batch.empty()) return;
+
+        enqueue([batch = std::move(_batch), use_uring = _uring] {
+            if (use_uring) {
+                uring::write_files(batch);
+                return;
+            }
+            for (auto &&[path, data] : batch) save(path, data);
+        });
+
+        _batch.clear();
+        _batch_bytes = 0;
+    }
+
+    void flush_copies() {
+        if (_copies.empty()) return;
+
+        enqueue([copies = std::move(_copies)] { uring::copy_files(copies); });
+        _copies.clear();
+    }
+
+    void wait_one() {
+        auto next = std::move(_pending.front());
+        _pending.pop_front();
+        next.get();
+    }
+
+  public:
+    expanded_output(const fs::path &root, fs::copy_options copy_options,
+                    unsigned jobs, unsigned open_files, bool use_uring)
+        : _root(root)
+        , _copy_options(copy_options)
+        , _uring(use_uring && uring::available()) {
+        if (use_uring && !_uring) {
+            LOG(logging::INFO, "io_uring unavailable; using threads");
+        }
+
+        if (!create_directory(_root)) {
+            for (auto &&entry : fs::recursive_directory_iterator(_root)) {
+                if (!entry.is_directory()) {
+                    _stale.insert(entry.path().lexically_relative(_root));
+                }
+            }
+        }
+
+        _directories.insert(_root);
+        write("mimetype", epub_mimetype);
+
+        // Each copy holds two descriptors open, and a batch submitted
+        // through io_uring up to uring::max_open.
+        auto per_task = _uring ? uring::max_open : 2;
+        auto limit = std::max(open_files / per_task, 1U);
+        if (jobs == 0) jobs = std::thread::hardware_concurrency();
+        if (jobs != 1 && limit > 1) {
+            _pool = std::make_unique<worker_pool>(std::min(jobs, limit));
+            _window = 4 * _pool->size();
+        }
+    }
+
+    void write(const fs::path &local, std::string_view data) override {
+        auto path = prepare(local);
+
+        if (!_pool && !_uring) {
+            save(path, data);
+            return;
+        }
+
+        // Small files are dominated by the cost of opening and closing
+        // them; hand them to the workers, or to the kernel, in batches
+        // so that the cost of a task is spread over many files.
+        _batch.push_back({std::move(path), std::string{data}});
+        _batch_bytes += data.size();
+
+        if (_batch.size() >= batch_files || _batch_bytes >= batch_bytes) {
+            flush_batch();
+        }
+    }
+
+    void generate(const fs::path &local,
+                  const std::function<void(std::ostream &)> &fn) override {
+        auto path = prepare(local);
+
+        std::ofstream out{path, std::ios::binary};
+        fn(out);
+        if (!out.flush()) {
+            throw fs::filesystem_error("unable to write", path,
+                                       std::io_errc::stream);
+        }
+    }
+
+    void copy(const fs::path &local, const fs::path &source) override {
+        auto path = prepare(local);
+
+        // Links are made one at a time.
+        if (_uring && _copy_options == fs::copy_options::none) {
+            _copies.push_back({source, std::move(path)});
+            if (_copies.size() >= batch_files) flush_copies();
+            return;
+        }
+
+        enqueue([source, path, copy_options = _copy_options] {
+            materialize(source, path, copy_options);
+        });
+    }
+
+    bool keep(const fs::path &local) override {
+        return _stale.erase(local) > 0;
+    }
+
+    void close() override {
+        flush_batch();
+        flush_copies();
+        while (!_pending.empty()) wait_one();
+
+        for (auto &&local : _stale) fs::remove(_root / local);
+        _stale.clear();
+    }
+};
+
+std::string read_file(const fs::path &source) {
+    std::ifstream in{source, std::ios::binary};
+    std::string data{std::istreambuf_iterator<char>{in}, {}};
+
+    if (in.bad() || !in.is_open()) {
+        throw fs::filesystem_error("unable to read", source,
+                                   std::io_errc::stream);
+    }
+
+    return data;
+}
+
+class packaged_output : public output {
+    /// The previous build, if the archive is being updated.
+    std::unique_ptr<zip::reader> _previous;
+
+    zip::writer _writer;
+    compression_policy _policy;
+
+    /// Compressed members not yet written, in archive order.
+    std::deque<std::future<zip::entry>> _pending;
+    std::size_t _window = 0;
+
+    std::unique_ptr<worker_pool> _pool;
+
+    template <class Fn>
+    void enqueue(Fn &&fn) {
+        if (!_pool) {
+            _writer.add(fn());
+            return;
+        }
+
+        _pending.push_back(_pool->submit(std::forward<Fn>(fn)));
+
+        // Bound the memory held by finished but unwritten members.
+        while (_pending.size() > _window) flush_one();
+    }
+
+    void flush_one() {
+        auto next = std::move(_pending.front());
+        _pending.pop_front();
+        _writer.add(next.get());
+    }
+
+  public:
+    packaged_output(const fs::path &path, const compression_policy &policy,
+                    unsigned jobs)
+        : _previous(exists(path) ? std::make_unique<zip::reader>(path)
+                                 : nullptr)
+        , _writer(path)
+        , _policy(policy) {
+        // The mimetype member must be first and must not be compressed.
+        _writer.add(zip::make_entry("mimetype", epub_mimetype, 0));
+
+        if (jobs != 1) {
+            _pool = std::make_unique<worker_pool>(jobs);
+            _window = 4 * _pool->size();
+        }
+    }
+
+    void write(const fs::path &local, std::string_view data) override {
+        enqueue([name = local.generic_string(), data = std::string{data},
+                 level = _policy.level_for(local),
+                 min_savings = _policy.min_savings] {
+            return zip::make_entry(name, data, level, min_savings);
+        });
+    }
+
+    void generate(const fs::path &local,
+                  const std::function<void(std::ostream &)> &fn) override {
+        // The member is written in place, after those before it.
+        while (!_pending.empty()) flush_one();
+        _writer.add(local.generic_string(), _policy.level_for(local), fn);
+    }
+
+    void copy(const fs::path &local, const fs::path &source) override {
+        enqueue([name = local.generic_string(), source,
+                 level = _policy.level_for(local),
+                 min_savings = _policy.min_savings] {
+            return zip::make_entry(name, read_file(source), level,
+                                   min_savings);
+        });
+    }
+
+    bool keep(const fs::path &local) override {
+        if (!_previous) return false;
+
+        auto member = _previous->get(local.generic_string());
+        if (!member) return false;
+
+        // Members are already encoded, so they bypass compression but
+        // still keep their place in the archive.
+        enqueue([e = std::move(*member)]() mutable { return std::move(e); });
+        return true;
+    }
+
+    void close() override {
+        while (!_pending.empty()) flush_one();
+
+        // The finished archive replaces the previous build.
+        _previous.reset();
+        _writer.close();
+    }
+};
+
+} // namespace
+
+std::unique_ptr<output> open_output(const fs::path &path,
+                                    const output_options &options) {
+    if (exists(path) && !options.incremental) {
+        throw fs::filesystem_error(
+            "open_output", path,
+            std::make_error_code(std::errc::file_exists));
+    }
+
+    switch (options.format) {
+        case output_format::expanded:
+            return std::make_unique<expanded_output>(
+                path, options.copy_options, options.jobs,
+                options.open_files, options.io_uring);
+        case output_format::packaged:
+            return std::make_unique<packaged_output>(
+                path, options.compression, options.jobs);
+    }
+
+    throw std::invalid_argument{__func__};
+}
+
+} // namespace epub
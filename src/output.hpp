@@ -0,0 +1,185 @@
+#ifndef _output_hpp_
+#define _output_hpp_
+
+#include "media_type.hpp"
+
+#include <filesystem>
+#include <functional>
+#include <iosfwd>
+#include <map>
+#include <memory>
+#include <string_view>
+
+namespace epub {
+
+/// @brief The physical form of a written publication.
+enum class output_format {
+    expanded, ///< A directory tree (an "expanded" EPUB).
+    packaged, ///< A single OCF ZIP archive (a ".epub" file).
+};
+
+/// @brief How the members of a packaged publication are compressed.
+///
+/// Formats that are already compressed gain nothing from DEFLATE, so
+/// by default the raster images are stored and everything else is
+/// deflated.
+///
+struct compression_policy {
+    /// @brief The zlib level for media types not listed in @c levels
+    /// (0 stores the member).
+    int level = 4;
+
+    /// @brief Levels for specific media types, overriding @c level.
+    std::map<std::u8string_view, int> levels = {
+        {gif_media_type, 0},
+        {jpeg_media_type, 0},
+        {png_media_type, 0},
+        {webp_media_type, 0},
+    };
+
+    /// @brief Members are stored unless deflating them saves at least
+    /// this percentage of their size.
+    unsigned min_savings = 5;
+
+    /// @brief The compression level for a container file.
+    ///
+    /// @param local the path of the file relative to the container root
+    /// @returns the level for the file's media type
+    ///
+    int level_for(const std::filesystem::path &local) const {
+        auto media = core_media.find(local.extension());
+        if (media == core_media.end()) return level;
+
+        auto found = levels.find(media->second);
+        return found == levels.end() ? level : found->second;
+    }
+};
+
+/// @brief Options controlling how a publication is written.
+struct output_options {
+    /// @brief The physical form of the publication.
+    output_format format = output_format::expanded;
+
+    /// @brief How source files are placed in an expanded publication.
+    ///
+    /// Ignored for packaged publications, which always embed a copy.
+    std::filesystem::copy_options copy_options =
+        std::filesystem::copy_options::none;
+
+    /// @brief How the members of packaged publications are compressed.
+    compression_policy compression;
+
+    /// @brief The number of files processed concurrently.
+    ///
+    /// Members of a packaged publication are compressed on this many
+    /// worker threads but are always written in the order they were
+    /// given, so the archive does not depend on the number of jobs.
+    /// Files of an expanded publication are written and copied
+    /// concurrently.
+    /// Zero selects the number of hardware threads.
+    unsigned jobs = 1;
+
+    /// @brief Update an existing publication rather than refusing to
+    /// overwrite it.
+    ///
+    /// The original is read while the new build is written, and is
+    /// only replaced when the output is closed.  See @c output::keep.
+    bool incremental = false;
+
+    /// @brief The most descriptors that concurrent copies into an
+    /// expanded publication may hold open at once.
+    unsigned open_files = 64;
+
+    /// @brief Write the files of an expanded publication through
+    /// io_uring.
+    ///
+    /// Files are then opened, written and closed, and copies opened
+    /// and closed, a batch per system call rather than one file at a
+    /// time.  Where the kernel does not provide io_uring the files are
+    /// written as if this were false.
+    bool io_uring = false;
+};
+
+/// @brief A destination for the files of an EPUB container.
+///
+/// Paths given to an @c output are relative to the root of the
+/// container.  The @c mimetype file is written when the output is
+/// opened so that it is always the first member of an archive.
+///
+class output {
+  public:
+    output() = default;
+
+    output(const output &) = delete;
+    output &operator=(const output &) = delete;
+
+    virtual ~output() = default;
+
+    /// @brief Create a container file with the given contents.
+    ///
+    /// @param local the path of the file relative to the container root
+    /// @param data the contents of the file
+    ///
+    virtual void write(const std::filesystem::path &local,
+                       std::string_view data) = 0;
+
+    /// @brief Create a container file from the output of a function.
+    ///
+    /// The data is written as @p fn produces it rather than being
+    /// collected first, so it need never be held in memory at once.
+    ///
+    /// @param local the path of the file relative to the container root
+    /// @param fn a function writing the contents of the file to the
+    ///   stream it is given
+    ///
+    virtual void generate(const std::filesystem::path &local,
+                          const std::function<void(std::ostream &)> &fn) = 0;
+
+    /// @brief Copy an external file into the container.
+    ///
+    /// @param local the path of the file relative to the container root
+    /// @param source the file to copy
+    ///
+    virtual void copy(const std::filesystem::path &local,
+                      const std::filesystem::path &source) = 0;
+
+    /// @brief Retain a file from the previous build.
+    ///
+    /// Only outputs opened with @c output_options::incremental have a
+    /// previous build.  The file is kept exactly as it was.
+    ///
+    /// @param local the path of the file relative to the container root
+    /// @returns false if there is no such file, in which case it must
+    ///   be written or copied instead
+    ///
+    virtual bool keep([[maybe_unused]] const std::filesystem::path &local) {
+        return false;
+    }
+
+    /// @brief Finish writing the container.
+    ///
+    /// No other methods may be called after the output is closed.
+    /// When updating a previous build, files that were neither written
+    /// nor kept are removed.
+    ///
+    virtual void close() = 0;
+};
+
+/// @brief Open a new container for writing.
+///
+/// A packaged publication is written to a temporary file that takes
+/// the place of @p path when the output is closed.  If the output is
+/// destroyed without being closed, the temporary file is removed.
+///
+/// @param path the name of the destination directory or archive
+/// @param options the format and its parameters
+/// @returns an output positioned after the @c mimetype file
+/// @throws std::filesystem::filesystem_error if @p path already exists
+///   and the output is not incremental
+///
+std::unique_ptr<output> open_output(const std::filesystem::path &path,
+                                    const output_options &options = {});
+
+} // namespace epub
+
+#endif
@@ -5,12 +5,19 @@
 #include "metadata.hpp"
 
 #include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace epub {
 
 class package {
+    /// @brief The manifest in insertion (and therefore spine) order.
     std::vector<manifest_item> _items;
 
+    /// @brief Indices into @c _items by id and by path.
+    std::unordered_map<std::u8string, std::size_t> _ids, _paths;
+
     class metadata _metadata;
 
   public:
@@ -25,13 +32,28 @@ class package {
         return std::ranges::ref_view(_items);
     }
 
+    /// @brief Add an item to the manifest.
+    ///
+    /// An item with an empty id is given a generated one.  Items are
+    /// not added if their id or path is already in the manifest.
+    ///
+    /// @param new_item the item to add
+    /// @returns a pair of an iterator to the item with the same id or
+    ///   path (or the new item) and whether the item was added
+    ///
     auto add_to_manifest(manifest_item new_item) {
         if (new_item.id.empty()) new_item.id = generate_id();
 
-        auto end = _items.end();
+        const auto index = _items.size();
+
+        auto [id, new_id] = _ids.try_emplace(new_item.id, index);
+        if (!new_id) return std::make_pair(_items.begin() + id->second, false);
 
-        for (auto iter = _items.begin(); iter != end; ++iter) {
-            if (iter->id == new_item.id) return std::make_pair(iter, false);
+        auto [path, new_path] =
+            _paths.try_emplace(new_item.path.generic_u8string(), index);
+        if (!new_path) {
+            _ids.erase(id);
+            return std::make_pair(_items.begin() + path->second, false);
         }
 
         _items.push_back(std::move(new_item));
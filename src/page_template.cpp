@@ -0,0 +1,123 @@
+#include "page_template.hpp"
+
+#include "minidom.hpp"
+#include "xml.hpp"
+#include "xml_writer.hpp"
+
+namespace epub::xml {
+
+namespace {
+
+std::string_view bytes(std::u8string_view s) {
+    return {reinterpret_cast<const char *>(s.data()), s.size()};
+}
+
+} // namespace
+
+page_template::page_template(std::u8string_view title,
+                             std::u8string_view stylesheet,
+                             std::u8string_view link) {
+    _prologue = "<?xml version=\"1.0\"?>\n<html xmlns=\"";
+    _prologue += bytes(xhtml_ns_uri);
+    _prologue += "\">\n  <head>\n    <title>";
+    escape_text(_prologue, title);
+    _prologue += "</title>\n    <meta name=\"viewport\" content=\"";
+
+    _head_end = "\"/>\n";
+    if (!link.empty()) {
+        _head_end += "    <link rel=\"stylesheet\" type=\"text/css\" href=\"";
+        escape_attribute(_head_end, link);
+        _head_end += "\"/>\n";
+    }
+    if (!stylesheet.empty()) {
+        _head_end += "    <style type=\"text/css\">";
+        write_cdata(_head_end, stylesheet);
+        _head_end += "</style>\n";
+    }
+    _head_end += "  </head>\n";
+}
+
+void page_template::render(std::string &buffer, std::u8string_view viewport,
+                           std::span<const page_image> images) const {
+    buffer = _prologue;
+    escape_attribute(buffer, viewport);
+    buffer += _head_end;
+
+    if (images.empty()) {
+        buffer += "  <body/>\n</html>\n";
+        return;
+    }
+
+    buffer += "  <body>\n";
+
+    for (auto &&image : images) {
+        buffer += "    <img";
+        if (!image.class_name.empty()) {
+            buffer += " class=\"";
+            escape_attribute(buffer, image.class_name);
+            buffer += '"';
+        }
+        if (!image.style.empty()) {
+            buffer += " style=\"";
+            escape_attribute(buffer, image.style);
+            buffer += '"';
+        }
+        buffer += " src=\"";
+        escape_attribute(buffer, image.src);
+        buffer += "\"/>\n";
+    }
+
+    buffer += "  </body>\n</html>\n";
+}
+
+namespace dom {
+
+std::string page_document(std::u8string_view title,
+                          std::u8string_view stylesheet,
+                          std::u8string_view link,
+                          std::u8string_view viewport,
+                          std::span<const page_image> images) {
+    auto doc = new_doc();
+    auto root = new_root_element(doc, u8"html");
+
+    set_ns(root, new_ns(root, xhtml_ns_uri));
+
+    auto head = new_child_node(root, nullptr, u8"head");
+    auto body = new_child_node(root, nullptr, u8"body");
+
+    new_child_node(head, nullptr, u8"title", std::u8string{title});
+
+    auto meta = new_child_node(head, nullptr, u8"meta");
+    set_attribute(meta, u8"name", u8"viewport");
+    set_attribute(meta, u8"content", std::u8string{viewport});
+
+    if (!link.empty()) {
+        auto ss_link = new_child_node(head, nullptr, u8"link");
+        set_attribute(ss_link, u8"rel", u8"stylesheet");
+        set_attribute(ss_link, u8"type", u8"text/css");
+        set_attribute(ss_link, u8"href", std::u8string{link});
+    }
+
+    if (!stylesheet.empty()) {
+        auto style = new_child_node(head, nullptr, u8"style");
+        set_attribute(style, u8"type", u8"text/css");
+        new_cdata_child(style, std::u8string{stylesheet});
+    }
+
+    for (auto &&image : images) {
+        auto img = new_child_node(body, nullptr, u8"img");
+        if (!image.class_name.empty()) {
+            set_attribute(img, u8"class", std::u8string{image.class_name});
+        }
+        if (!image.style.empty()) {
+            set_attribute(img, u8"style", std::u8string{image.style});
+        }
+        set_attribute(img, u8"src", std::u8string{image.src});
+    }
+
+    return save_string(doc, true);
+}
+
+} // namespace dom
+
+} // namespace epub::xml
@@ -0,0 +1,73 @@
+#ifndef _page_template_hpp_
+#define _page_template_hpp_
+
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace epub::xml {
+
+/// @brief An image placed on a fixed-layout page.
+struct page_image {
+    /// @brief The CSS class positioning the image, or empty for none.
+    std::u8string_view class_name;
+    /// @brief The CSS positioning the image on the page, or empty for
+    /// none.
+    std::u8string_view style;
+    /// @brief The URL of the image relative to the page.
+    std::u8string_view src;
+};
+
+/// @brief A precompiled fixed-layout XHTML page.
+///
+/// Every page of a comic has the same shape: a title, a viewport,
+/// optional linked and inline stylesheets, and a list of absolutely
+/// positioned images.
+/// The constant text is prepared once and each page is written
+/// directly into a caller-supplied buffer, so no document tree is
+/// built.  The output is the same as that of @c dom::page_document.
+///
+class page_template {
+    std::string _prologue;
+    std::string _head_end;
+
+  public:
+    /// @brief Prepare the constant parts of the page.
+    ///
+    /// @param title the title of every page
+    /// @param stylesheet CSS included in every page, or empty for none
+    /// @param link the URL of a stylesheet linked from every page, or
+    ///   empty for none
+    ///
+    explicit page_template(std::u8string_view title,
+                           std::u8string_view stylesheet = {},
+                           std::u8string_view link = {});
+
+    /// @brief Write a page.
+    ///
+    /// @param buffer the destination; its previous contents are
+    ///   replaced but its storage is reused
+    /// @param viewport the content of the viewport @c meta element
+    /// @param images the images on the page
+    ///
+    void render(std::string &buffer, std::u8string_view viewport,
+                std::span<const page_image> images) const;
+};
+
+namespace dom {
+
+/// @brief Build a page as a libxml2 tree.
+///
+/// This is the reference for @c page_template.
+///
+extern std::string page_document(std::u8string_view title,
+                                 std::u8string_view stylesheet,
+                                 std::u8string_view link,
+                                 std::u8string_view viewport,
+                                 std::span<const page_image> images);
+
+} // namespace dom
+
+} // namespace epub::xml
+
+#endif
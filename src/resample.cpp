@@ -0,0 +1,489 @@
+#include "resample.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <csetjmp>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <numbers>
+#include <stdexcept>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#ifdef HAVE_LIBJPEG
+#include <jpeglib.h>
+#endif
+
+#ifdef HAVE_LIBPNG
+#include <png.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace epub::comic {
+
+namespace {
+
+constexpr double lobes = 3;
+
+double lanczos(double x) {
+    x = std::abs(x);
+    if (x >= lobes) return 0;
+    if (x < 1e-9) return 1;
+
+    auto px = std::numbers::pi * x;
+    return lobes * std::sin(px) * std::sin(px / lobes) / (px * px);
+}
+
+/// The weights of the source samples contributing to each result
+/// sample.  Every result sample has the same number of taps, so the
+/// window is shifted rather than cut short at the edges.
+struct filter {
+    std::size_t taps;
+    std::vector<std::size_t> first;
+    std::vector<float> weights;
+
+    filter(geom::coord from, geom::coord to)
+        : first(to) {
+        const double ratio = static_cast<double>(from) / to;
+        const double scale = std::max(ratio, 1.0);
+        const double radius = lobes * scale;
+
+        taps = std::min<std::size_t>(
+            2 * static_cast<std::size_t>(std::ceil(radius)) + 1, from);
+        weights.resize(taps * to);
+
+        std::vector<double> w(taps);
+
+        for (geom::coord i = 0; i < to; ++i) {
+            const double center = (i + 0.5) * ratio;
+            auto start = std::clamp(std::ceil(center - radius - 0.5), 0.0,
+                                    static_cast<double>(from - taps));
+            first[i] = static_cast<std::size_t>(start);
+
+            double total = 0;
+            for (std::size_t k = 0; k < taps; ++k) {
+                w[k] = lanczos((start + k + 0.5 - center) / scale);
+                total += w[k];
+            }
+
+            for (std::size_t k = 0; k < taps; ++k) {
+                weights[i * taps + k] = static_cast<float>(w[k] / total);
+            }
+        }
+    }
+};
+
+using kernel = void (*)(float *sum, const float *row, float weight,
+                        std::size_t n);
+
+void accumulate_scalar(float *sum, const float *row, float weight,
+                       std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) sum[i] += weight * row[i];
+}
+
+#if defined(__x86_64__)
+
+__attribute__((target("avx2"))) void
+accumulate_avx2(float *sum, const float *row, float weight, std::size_t n) {
+    const auto w = _mm256_set1_ps(weight);
+
+    std::size_t i = 0;
+
+    // Multiplied and added separately, as the scalar loop, so that
+    // both give the same result.
+    for (; i + 8 <= n; i += 8) {
+        auto s = _mm256_add_ps(_mm256_loadu_ps(sum + i),
+                               _mm256_mul_ps(w, _mm256_loadu_ps(row + i)));
+        _mm256_storeu_ps(sum + i, s);
+    }
+
+    accumulate_scalar(sum + i, row + i, weight, n - i);
+}
+
+#elif defined(__aarch64__)
+
+void accumulate_neon(float *sum, const float *row, float weight,
+                     std::size_t n) {
+    const auto w = vdupq_n_f32(weight);
+
+    std::size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        vst1q_f32(sum + i, vaddq_f32(vld1q_f32(sum + i),
+                                     vmulq_f32(w, vld1q_f32(row + i))));
+    }
+
+    accumulate_scalar(sum + i, row + i, weight, n - i);
+}
+
+#endif
+
+kernel select() {
+    static const kernel chosen = [] {
+#if defined(__x86_64__)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) return accumulate_avx2;
+#elif defined(__aarch64__)
+        return accumulate_neon;
+#endif
+        return accumulate_scalar;
+    }();
+
+    return chosen;
+}
+
+std::uint8_t to_sample(float v) {
+    return static_cast<std::uint8_t>(std::lround(std::clamp(v, 0.0f, 255.0f)));
+}
+
+std::string read_file(const fs::path &source) {
+    std::ifstream in{source, std::ios::binary};
+    std::string data{std::istreambuf_iterator<char>{in}, {}};
+
+    if (in.bad() || !in.is_open()) {
+        throw fs::filesystem_error("unable to read", source,
+                                   std::io_errc::stream);
+    }
+
+    return data;
+}
+
+#if defined(HAVE_LIBJPEG) || defined(HAVE_LIBPNG)
+
+std::runtime_error decode_error(const fs::path &source, const char *what) {
+    return std::runtime_error{source.string() + ": " + what};
+}
+
+#endif
+
+#ifdef HAVE_LIBJPEG
+
+// libjpeg reports errors through error_exit, which must not return.
+// It jumps back to the function that called into the library, which
+// destroys its state and returns false.  No C++ object with a
+// destructor may be created between the jump and its target.
+
+struct jpeg_state {
+    jpeg_error_mgr errors;
+    std::jmp_buf resume;
+    char message[JMSG_LENGTH_MAX] = {};
+
+    /// The encoded image, allocated by libjpeg.
+    unsigned char *buffer = nullptr;
+    unsigned long length = 0;
+
+    jpeg_state() = default;
+    jpeg_state(const jpeg_state &) = delete;
+    jpeg_state &operator=(const jpeg_state &) = delete;
+
+    ~jpeg_state() {
+        std::free(buffer);
+    }
+};
+
+[[noreturn]] void jpeg_fail(j_common_ptr cinfo) {
+    auto state = reinterpret_cast<jpeg_state *>(cinfo->err);
+    (*cinfo->err->format_message)(cinfo, state->message);
+    std::longjmp(state->resume, 1);
+}
+
+/// Decode at the smallest scale no smaller than @p size, leaving
+/// @p image empty if the image is already small enough or is not in
+/// a colour model that can be encoded again.
+bool decode_jpeg(const std::string &data, const geom::size &size,
+                 bitmap &image, jpeg_state &state) {
+    jpeg_decompress_struct cinfo{};
+    cinfo.err = jpeg_std_error(&state.errors);
+    state.errors.error_exit = jpeg_fail;
+
+    if (setjmp(state.resume)) {
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
+
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo, reinterpret_cast<const unsigned char *>(data.data()),
+                 static_cast<unsigned long>(data.size()));
+    jpeg_read_header(&cinfo, TRUE);
+
+    const bool supported = cinfo.jpeg_color_space == JCS_GRAYSCALE ||
+                           cinfo.jpeg_color_space == JCS_YCbCr ||
+                           cinfo.jpeg_color_space == JCS_RGB;
+
+    if (!supported ||
+        (cinfo.image_width <= size.w && cinfo.image_height <= size.h)) {
+        jpeg_destroy_decompress(&cinfo);
+        return true;
+    }
+
+    cinfo.out_color_space =
+        cinfo.jpeg_color_space == JCS_GRAYSCALE ? JCS_GRAYSCALE : JCS_RGB;
+
+    // The decoder scales by 1/2, 1/4 or 1/8 as cheaply as it decodes.
+    cinfo.scale_num = 1;
+    for (unsigned d = 8; d > 1; d /= 2) {
+        if ((cinfo.image_width + d - 1) / d >= size.w &&
+            (cinfo.image_height + d - 1) / d >= size.h) {
+            cinfo.scale_denom = d;
+            break;
+        }
+    }
+
+    jpeg_start_decompress(&cinfo);
+
+    image.size = {cinfo.output_width, cinfo.output_height};
+    image.channels = static_cast<unsigned>(cinfo.output_components);
+
+    const std::size_t stride = std::size_t{image.size.w} * image.channels;
+    image.pixels.resize(stride * image.size.h);
+
+    while (cinfo.output_scanline < cinfo.output_height) {
+        JSAMPROW row = &image.pixels[cinfo.output_scanline * stride];
+        jpeg_read_scanlines(&cinfo, &row, 1);
+    }
+
+    jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+    return true;
+}
+
+bool encode_jpeg(const bitmap &image, jpeg_state &state) {
+    jpeg_compress_struct cinfo{};
+    cinfo.err = jpeg_std_error(&state.errors);
+    state.errors.error_exit = jpeg_fail;
+
+    if (setjmp(state.resume)) {
+        jpeg_destroy_compress(&cinfo);
+        return false;
+    }
+
+    jpeg_create_compress(&cinfo);
+    jpeg_mem_dest(&cinfo, &state.buffer, &state.length);
+
+    cinfo.image_width = image.size.w;
+    cinfo.image_height = image.size.h;
+    cinfo.input_components = static_cast<int>(image.channels);
+    cinfo.in_color_space = image.channels == 1 ? JCS_GRAYSCALE : JCS_RGB;
+
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, jpeg_quality, TRUE);
+    jpeg_start_compress(&cinfo, TRUE);
+
+    const std::size_t stride = std::size_t{image.size.w} * image.channels;
+
+    while (cinfo.next_scanline < cinfo.image_height) {
+        auto row = const_cast<JSAMPROW>(
+            &image.pixels[cinfo.next_scanline * stride]);
+        jpeg_write_scanlines(&cinfo, &row, 1);
+    }
+
+    jpeg_finish_compress(&cinfo);
+    jpeg_destroy_compress(&cinfo);
+    return true;
+}
+
+std::optional<std::string> resample_jpeg(const fs::path &source,
+                                         const std::string &data,
+                                         const geom::size &size) {
+    bitmap image;
+
+    if (jpeg_state state; !decode_jpeg(data, size, image, state)) {
+        throw decode_error(source, state.message);
+    }
+    if (image.pixels.empty()) return std::nullopt;
+
+    jpeg_state state;
+    if (!encode_jpeg(resize(image, size), state)) {
+        throw std::runtime_error{state.message};
+    }
+
+    return std::string{reinterpret_cast<const char *>(state.buffer),
+                       state.length};
+}
+
+#endif
+
+#ifdef HAVE_LIBPNG
+
+// The simplified libpng API reports errors in the image structure,
+// which it frees, rather than by jumping.
+
+std::optional<std::string> resample_png(const fs::path &source,
+                                        const std::string &data,
+                                        const geom::size &size) {
+    png_image png{};
+    png.version = PNG_IMAGE_VERSION;
+
+    if (!png_image_begin_read_from_memory(&png, data.data(), data.size())) {
+        throw decode_error(source, png.message);
+    }
+
+    if (png.width <= size.w && png.height <= size.h) {
+        png_image_free(&png);
+        return std::nullopt;
+    }
+
+    // Samples are reduced to eight bits and palettes expanded.
+    png.format &= ~(PNG_FORMAT_FLAG_LINEAR | PNG_FORMAT_FLAG_COLORMAP);
+
+    bitmap image{{png.width, png.height},
+                 PNG_IMAGE_SAMPLE_CHANNELS(png.format),
+                 std::vector<std::uint8_t>(PNG_IMAGE_SIZE(png))};
+
+    if (!png_image_finish_read(&png, nullptr, image.pixels.data(), 0,
+                               nullptr)) {
+        throw decode_error(source, png.message);
+    }
+
+    image = resize(image, size);
+
+    png = {};
+    png.version = PNG_IMAGE_VERSION;
+    png.width = image.size.w;
+    png.height = image.size.h;
+    png.format = image.channels - 1;
+
+    static_assert(PNG_FORMAT_GA == 1 && PNG_FORMAT_RGB == 2 &&
+                  PNG_FORMAT_RGBA == 3);
+
+    png_alloc_size_t length = PNG_IMAGE_PNG_SIZE_MAX(png);
+    std::string result(length, '\0');
+
+    if (!png_image_write_to_memory(&png, result.data(), &length, 0,
+                                   image.pixels.data(), 0, nullptr)) {
+        throw std::runtime_error{png.message};
+    }
+
+    result.resize(length);
+    return result;
+}
+
+#endif
+
+} // namespace
+
+bitmap resize(const bitmap &image, const geom::size &size) {
+    const auto channels = image.channels;
+
+    if (channels < 1 || channels > 4 || image.size.w == 0 ||
+        image.size.h == 0 || size.w == 0 || size.h == 0 ||
+        image.pixels.size() !=
+            std::size_t{image.size.w} * image.size.h * channels) {
+        throw std::invalid_argument{__func__};
+    }
+
+    if (image.size == size) return image;
+
+    const filter fx{image.size.w, size.w}, fy{image.size.h, size.h};
+    const auto accumulate = select();
+
+    const bool alpha = channels % 2 == 0;
+    const auto color = alpha ? channels - 1 : channels;
+
+    const std::size_t source_row = std::size_t{image.size.w} * channels;
+    const std::size_t result_row = std::size_t{size.w} * channels;
+
+    // Source rows are converted as the filter reaches them, with colour
+    // weighted by alpha, and kept while the filter still covers them.
+    std::vector<float> window(fy.taps * source_row);
+    std::vector<float> column(source_row);
+    std::size_t next = 0;
+
+    auto convert = [&](std::size_t y) {
+        const auto *in = &image.pixels[y * source_row];
+        auto *out = &window[(y % fy.taps) * source_row];
+
+        for (std::size_t i = 0; i < source_row; ++i) out[i] = in[i];
+
+        if (alpha) {
+            for (std::size_t i = 0; i < source_row; i += channels) {
+                const auto a = out[i + color] / 255.0f;
+                for (unsigned c = 0; c < color; ++c) out[i + c] *= a;
+            }
+        }
+    };
+
+    bitmap result{size, channels,
+                  std::vector<std::uint8_t>(result_row * size.h)};
+
+    for (geom::coord y = 0; y < size.h; ++y) {
+        const auto first = fy.first[y];
+        for (; next < first + fy.taps; ++next) convert(next);
+
+        std::ranges::fill(column, 0.0f);
+        for (std::size_t k = 0; k < fy.taps; ++k) {
+            accumulate(column.data(),
+                       &window[((first + k) % fy.taps) * source_row],
+                       fy.weights[y * fy.taps + k], source_row);
+        }
+
+        auto *out = &result.pixels[y * result_row];
+
+        for (geom::coord x = 0; x < size.w; ++x) {
+            const auto *w = &fx.weights[x * fx.taps];
+            const auto *in = &column[fx.first[x] * channels];
+
+            float px[4] = {};
+            for (std::size_t k = 0; k < fx.taps; ++k) {
+                for (unsigned c = 0; c < channels; ++c) {
+                    px[c] += w[k] * in[k * channels + c];
+                }
+            }
+
+            if (alpha) {
+                const auto a = px[color];
+                for (unsigned c = 0; c < color; ++c) {
+                    px[c] = a > 0 ? px[c] * 255.0f / a : 0;
+                }
+            }
+
+            for (unsigned c = 0; c < channels; ++c) {
+                out[x * channels + c] = to_sample(px[c]);
+            }
+        }
+    }
+
+    return result;
+}
+
+bool can_resample([[maybe_unused]] std::u8string_view media_type) {
+#ifdef HAVE_LIBJPEG
+    if (media_type == u8"image/jpeg") return true;
+#endif
+#ifdef HAVE_LIBPNG
+    if (media_type == u8"image/png") return true;
+#endif
+    return false;
+}
+
+std::optional<std::string> resample(const fs::path &source,
+                                    std::u8string_view media_type,
+                                    const geom::size &size) {
+    if (!can_resample(media_type)) return std::nullopt;
+
+    const auto data = read_file(source);
+    std::optional<std::string> result;
+
+#ifdef HAVE_LIBJPEG
+    if (media_type == u8"image/jpeg") {
+        result = resample_jpeg(source, data, size);
+    }
+#endif
+#ifdef HAVE_LIBPNG
+    if (media_type == u8"image/png") {
+        result = resample_png(source, data, size);
+    }
+#endif
+
+    if (result && result->size() >= data.size()) return std::nullopt;
+    return result;
+}
+
+} // namespace epub::comic
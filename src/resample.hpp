@@ -0,0 +1,74 @@
+#ifndef _resample_hpp_
+#define _resample_hpp_
+
+#include "geom.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace epub::comic {
+
+/// @brief An image in memory, with 8-bit samples.
+///
+/// The samples of each pixel are interleaved, and the pixels are
+/// stored by row.  With two or four channels the last is alpha.
+///
+struct bitmap {
+    geom::size size;
+    unsigned channels = 0;
+    std::vector<std::uint8_t> pixels;
+};
+
+/// @brief The quality at which resampled JPEG images are encoded.
+constexpr int jpeg_quality = 90;
+
+/// @brief Resize an image.
+///
+/// The image is filtered with a Lanczos-3 kernel, widened when
+/// shrinking so that every source pixel contributes.  Columns are
+/// filtered first, a row at a time over the full width, where the
+/// work is greatest; those rows are summed with AVX2 (checked when
+/// first called) or NEON where the processor supports it.  Colour is
+/// weighted by alpha, so that transparent pixels do not bleed into
+/// their neighbours.
+///
+/// @param image the image to resize
+/// @param size the size of the result
+/// @returns the resized image
+/// @throws std::invalid_argument if either image would be empty or
+///   the image has other than one to four channels
+///
+bitmap resize(const bitmap &image, const geom::size &size);
+
+/// @brief Whether images of a media type can be resampled.
+///
+/// JPEG and PNG images can be resampled if the program was built
+/// with libjpeg and libpng respectively.
+///
+bool can_resample(std::u8string_view media_type);
+
+/// @brief Scale an image file down.
+///
+/// The image is decoded, resized and encoded in its own format.
+/// Metadata such as EXIF data and colour profiles is not kept.
+/// JPEG images are decoded at the smallest of the scales the format
+/// supports that is no smaller than @p size.
+///
+/// @param source the image file
+/// @param media_type the media type of the file
+/// @param size the size of the result
+/// @returns the encoded image, or nothing if the image is no larger
+///   than @p size, cannot be resampled, or would not get smaller
+/// @throws std::runtime_error if the image cannot be decoded
+///
+std::optional<std::string> resample(const std::filesystem::path &source,
+                                    std::u8string_view media_type,
+                                    const geom::size &size);
+
+} // namespace epub::comic
+
+#endif
@@ -0,0 +1,432 @@
+#include "uring.hpp"
+
+#include "copy_file.hpp"
+#include "logging.hpp"
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define EPUB_HAVE_URING 1
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace epub::uring {
+
+#ifdef EPUB_HAVE_URING
+
+namespace {
+
+/// A submission and completion queue, driven with the raw system
+/// calls so that liburing is not needed.  Each ring belongs to one
+/// thread.
+class ring {
+    int _fd = -1;
+    unsigned _entries = 0;
+
+    void *_rings = MAP_FAILED;
+    std::size_t _rings_size = 0;
+
+    void *_sqes = MAP_FAILED;
+    std::size_t _sqes_size = 0;
+
+    unsigned *_sq_tail = nullptr;
+    unsigned *_sq_mask = nullptr;
+    unsigned *_sq_array = nullptr;
+
+    unsigned *_cq_head = nullptr;
+    unsigned *_cq_tail = nullptr;
+    unsigned *_cq_mask = nullptr;
+    io_uring_cqe *_cqes = nullptr;
+
+    /// Entries filled in but not yet submitted.
+    unsigned _queued = 0;
+
+    void release() noexcept {
+        if (_sqes != MAP_FAILED) ::munmap(_sqes, _sqes_size);
+        if (_rings != MAP_FAILED) ::munmap(_rings, _rings_size);
+        if (_fd >= 0) ::close(_fd);
+    }
+
+    [[noreturn]] void fail(const char *what) {
+        auto error = errno;
+        release();
+        throw std::system_error(error, std::generic_category(), what);
+    }
+
+  public:
+    explicit ring(unsigned entries) {
+        io_uring_params params{};
+
+        _fd = static_cast<int>(
+            ::syscall(__NR_io_uring_setup, entries, &params));
+        if (_fd < 0) fail("io_uring_setup");
+
+        // Kernels without a single mapping (before 5.4) lack the
+        // opcodes used here anyway.
+        if (!(params.features & IORING_FEAT_SINGLE_MMAP)) {
+            errno = ENOSYS;
+            fail("io_uring_setup");
+        }
+
+        _entries = params.sq_entries;
+
+        _rings_size = std::max(
+            params.sq_off.array + params.sq_entries * sizeof(unsigned),
+            params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+        _rings = ::mmap(nullptr, _rings_size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQ_RING);
+        if (_rings == MAP_FAILED) fail("mmap");
+
+        _sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        _sqes = ::mmap(nullptr, _sqes_size, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQES);
+        if (_sqes == MAP_FAILED) fail("mmap");
+
+        auto base = static_cast<char *>(_rings);
+        auto at = [base](std::uint32_t offset) {
+            return reinterpret_cast<unsigned *>(base + offset);
+        };
+
+        _sq_tail = at(params.sq_off.tail);
+        _sq_mask = at(params.sq_off.ring_mask);
+        _sq_array = at(params.sq_off.array);
+        _cq_head = at(params.cq_off.head);
+        _cq_tail = at(params.cq_off.tail);
+        _cq_mask = at(params.cq_off.ring_mask);
+        _cqes = reinterpret_cast<io_uring_cqe *>(base + params.cq_off.cqes);
+    }
+
+    ring(const ring &) = delete;
+    ring &operator=(const ring &) = delete;
+
+    ~ring() {
+        release();
+    }
+
+    /// True if the kernel implements every one of @p opcodes.
+    bool supports(std::initializer_list<std::uint8_t> opcodes) const {
+        std::vector<std::uint8_t> buffer(sizeof(io_uring_probe) +
+                                         256 * sizeof(io_uring_probe_op));
+        auto probe = reinterpret_cast<io_uring_probe *>(buffer.data());
+
+        if (::syscall(__NR_io_uring_register, _fd, IORING_REGISTER_PROBE,
+                      probe, 256) < 0) {
+            return false;
+        }
+
+        return std::ranges::all_of(opcodes, [probe](auto op) {
+            return op <= probe->last_op &&
+                   (probe->ops[op].flags & IO_URING_OP_SUPPORTED);
+        });
+    }
+
+    /// Queue an operation, returning its entry for the caller to fill.
+    /// The operation is submitted by the next call to @c complete.
+    io_uring_sqe &push(std::uint8_t opcode, std::uint64_t user_data) {
+        if (_queued == _entries) throw std::length_error{"ring is full"};
+
+        auto index = (*_sq_tail + _queued++) & *_sq_mask;
+        _sq_array[index] = index;
+
+        auto &sqe = static_cast<io_uring_sqe *>(_sqes)[index];
+        std::memset(&sqe, 0, sizeof sqe);
+        sqe.opcode = opcode;
+        sqe.user_data = user_data;
+        return sqe;
+    }
+
+    /// Submit the queued operations and wait for all of them, passing
+    /// the user data and result of each to @p fn as it completes.
+    template <class Fn>
+    void complete(Fn fn) {
+        auto submit = _queued;
+        auto outstanding = _queued;
+        _queued = 0;
+
+        __atomic_store_n(_sq_tail, *_sq_tail + submit, __ATOMIC_RELEASE);
+
+        while (outstanding > 0) {
+            auto n = ::syscall(__NR_io_uring_enter, _fd, submit, 1,
+                               IORING_ENTER_GETEVENTS, nullptr, 0);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                throw std::system_error(errno, std::generic_category(),
+                                        "io_uring_enter");
+            }
+            submit -= static_cast<unsigned>(n);
+
+            auto head = *_cq_head;
+            auto tail = __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE);
+            for (; head != tail; ++head, --outstanding) {
+                auto &cqe = _cqes[head & *_cq_mask];
+                fn(cqe.user_data, cqe.res);
+            }
+            __atomic_store_n(_cq_head, head, __ATOMIC_RELEASE);
+        }
+    }
+};
+
+/// Room for a write and a close for each of @c max_open files.
+constexpr unsigned ring_entries = 2 * max_open;
+
+/// The longest single write submitted; the rest of a longer file is
+/// written directly.
+constexpr std::size_t max_write = 1U << 30;
+
+ring &this_thread_ring() {
+    thread_local ring r{ring_entries};
+    return r;
+}
+
+std::uint64_t address(const void *p) {
+    return reinterpret_cast<std::uintptr_t>(p);
+}
+
+/// Write what a short write left of @p data.  Returns an error number,
+/// or zero on success.
+int finish_write(int fd, std::string_view data, std::size_t done) {
+    while (done < data.size()) {
+        auto n = ::pwrite(fd, data.data() + done, data.size() - done,
+                          static_cast<off_t>(done));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return errno;
+        }
+        if (n == 0) return EIO;
+        done += static_cast<std::size_t>(n);
+    }
+
+    return 0;
+}
+
+void write_part(ring &r, std::span<const file_write> files,
+                std::optional<fs::filesystem_error> &error) {
+    std::vector<int> fds(files.size(), -1);
+    std::vector<int> errors(files.size(), 0);
+
+    for (std::size_t i = 0; i < files.size(); ++i) {
+        auto &sqe = r.push(IORING_OP_OPENAT, i);
+        sqe.fd = AT_FDCWD;
+        sqe.addr = address(files[i].path.c_str());
+        sqe.len = 0666;
+        sqe.open_flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+    }
+
+    r.complete([&](std::uint64_t i, int res) {
+        if (res < 0) errors[i] = -res;
+        else fds[i] = res;
+    });
+
+    // Link each write to its close, so that the close waits for it.
+    // A failed or short write cancels the close, leaving the file open
+    // to be finished below.
+    std::vector<int> written(files.size(), 0);
+    std::vector<int> closed(files.size(), 0);
+
+    for (std::size_t i = 0; i < files.size(); ++i) {
+        if (fds[i] < 0) continue;
+
+        auto &data = files[i].data;
+        if (!data.empty()) {
+            auto &sqe = r.push(IORING_OP_WRITE, 2 * i);
+            sqe.fd = fds[i];
+            sqe.addr = address(data.data());
+            sqe.len =
+                static_cast<std::uint32_t>(std::min(data.size(), max_write));
+            sqe.off = 0;
+            sqe.flags = IOSQE_IO_LINK;
+        }
+
+        r.push(IORING_OP_CLOSE, 2 * i + 1).fd = fds[i];
+    }
+
+    r.complete([&](std::uint64_t tag, int res) {
+        (tag % 2 ? closed : written)[tag / 2] = res;
+    });
+
+    for (std::size_t i = 0; i < files.size(); ++i) {
+        if (fds[i] < 0) continue;
+
+        auto &data = files[i].data;
+        auto done = static_cast<std::size_t>(std::max(written[i], 0));
+        if (written[i] < 0) errors[i] = -written[i];
+
+        if (closed[i] == -ECANCELED) {
+            if (!errors[i]) errors[i] = finish_write(fds[i], data, done);
+            if (::close(fds[i]) < 0 && !errors[i]) errors[i] = errno;
+        }
+        else if (closed[i] < 0) {
+            if (!errors[i]) errors[i] = -closed[i];
+        }
+        else if (!errors[i] && done < data.size()) {
+            errors[i] = EIO;
+        }
+    }
+
+    for (std::size_t i = 0; i < files.size() && !error; ++i) {
+        if (errors[i]) {
+            error.emplace("write", files[i].path,
+                          std::error_code{errors[i], std::generic_category()});
+        }
+    }
+}
+
+void copy_part(ring &r, std::span<const file_copy> files,
+               std::optional<fs::filesystem_error> &error) {
+    std::vector<int> in(files.size(), -1);
+    std::vector<int> out(files.size(), -1);
+    std::vector<int> errors(files.size(), 0);
+    std::vector<struct statx> stats(files.size());
+
+    for (std::size_t i = 0; i < files.size(); ++i) {
+        auto &open = r.push(IORING_OP_OPENAT, 2 * i);
+        open.fd = AT_FDCWD;
+        open.addr = address(files[i].source.c_str());
+        open.open_flags = O_RDONLY | O_CLOEXEC;
+
+        auto &stat = r.push(IORING_OP_STATX, 2 * i + 1);
+        stat.fd = AT_FDCWD;
+        stat.addr = address(files[i].source.c_str());
+        stat.len = STATX_MODE | STATX_SIZE;
+        stat.off = address(&stats[i]);
+    }
+
+    r.complete([&](std::uint64_t tag, int res) {
+        auto i = tag / 2;
+        if (res < 0) {
+            if (!errors[i]) errors[i] = -res;
+        }
+        else if (tag % 2 == 0) {
+            in[i] = res;
+        }
+    });
+
+    for (std::size_t i = 0; i < files.size(); ++i) {
+        if (errors[i]) continue;
+
+        auto &sqe = r.push(IORING_OP_OPENAT, i);
+        sqe.fd = AT_FDCWD;
+        sqe.addr = address(files[i].path.c_str());
+        sqe.len = stats[i].stx_mode & 0777;
+        sqe.open_flags = O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC;
+    }
+
+    r.complete([&](std::uint64_t i, int res) {
+        if (res < 0) errors[i] = -res;
+        else out[i] = res;
+    });
+
+    for (std::size_t i = 0; i < files.size(); ++i) {
+        if (errors[i]) continue;
+
+        try {
+            auto method = copy_contents(in[i], out[i], stats[i].stx_size,
+                                        files[i].source, files[i].path);
+            LOG(logging::DEBUG, "copied ", files[i].source, " using ",
+                method);
+        }
+        catch (fs::filesystem_error &e) {
+            errors[i] = e.code().value();
+        }
+    }
+
+    for (std::size_t i = 0; i < files.size(); ++i) {
+        if (in[i] >= 0) r.push(IORING_OP_CLOSE, 2 * i).fd = in[i];
+        if (out[i] >= 0) r.push(IORING_OP_CLOSE, 2 * i + 1).fd = out[i];
+    }
+
+    r.complete([&](std::uint64_t tag, int res) {
+        // Only a failure to close the copy can lose data.
+        if (res < 0 && tag % 2 && !errors[tag / 2]) errors[tag / 2] = -res;
+    });
+
+    for (std::size_t i = 0; i < files.size(); ++i) {
+        if (!errors[i]) continue;
+
+        if (out[i] >= 0) ::unlink(files[i].path.c_str());
+        if (!error) {
+            error.emplace("copy_file", files[i].source, files[i].path,
+                          std::error_code{errors[i], std::generic_category()});
+        }
+    }
+}
+
+} // namespace
+
+bool available() {
+    static const bool supported = [] {
+        try {
+            return this_thread_ring().supports({IORING_OP_OPENAT,
+                                                IORING_OP_WRITE,
+                                                IORING_OP_CLOSE,
+                                                IORING_OP_STATX});
+        }
+        catch (std::system_error &e) {
+            LOG(logging::DEBUG, "io_uring is unavailable: ", e.what());
+            return false;
+        }
+    }();
+
+    return supported;
+}
+
+void write_files(std::span<const file_write> files) {
+    auto &r = this_thread_ring();
+    std::optional<fs::filesystem_error> error;
+
+    for (std::size_t i = 0; i < files.size(); i += max_open) {
+        auto n = std::min<std::size_t>(max_open, files.size() - i);
+        write_part(r, files.subspan(i, n), error);
+    }
+
+    if (error) throw *error;
+}
+
+void copy_files(std::span<const file_copy> files) {
+    auto &r = this_thread_ring();
+    std::optional<fs::filesystem_error> error;
+
+    // Each copy holds two descriptors.
+    for (std::size_t i = 0; i < files.size(); i += max_open / 2) {
+        auto n = std::min<std::size_t>(max_open / 2, files.size() - i);
+        copy_part(r, files.subspan(i, n), error);
+    }
+
+    if (error) throw *error;
+}
+
+#else
+
+bool available() {
+    return false;
+}
+
+void write_files(std::span<const file_write>) {
+    throw std::system_error(
+        std::make_error_code(std::errc::function_not_supported), "io_uring");
+}
+
+void copy_files(std::span<const file_copy>) {
+    throw std::system_error(
+        std::make_error_code(std::errc::function_not_supported), "io_uring");
+}
+
+#endif
+
+} // namespace epub::uring
@@ -0,0 +1,66 @@
+#ifndef _uring_hpp_
+#define _uring_hpp_
+
+#include <filesystem>
+#include <span>
+#include <string>
+
+namespace epub::uring {
+
+/// @brief A file to be created with the given contents.
+struct file_write {
+    std::filesystem::path path;
+    std::string data;
+};
+
+/// @brief A file to be created as a copy of another.
+struct file_copy {
+    std::filesystem::path source;
+    std::filesystem::path path;
+};
+
+/// @brief The most descriptors a batch holds open at once.
+///
+/// Batches larger than this are submitted in several parts.
+///
+constexpr unsigned max_open = 32;
+
+/// @brief Whether the kernel supports the operations used here.
+///
+/// The answer is found by creating a ring and probing it the first
+/// time this is called.  It is false on systems other than Linux,
+/// and where io_uring is disabled or forbidden to the process.
+///
+bool available();
+
+/// @brief Create and write a batch of files.
+///
+/// The files are opened in one submission, and written and closed
+/// in a second, so each part of the batch costs two system calls
+/// however many files it holds.  Existing files are truncated.
+///
+/// @param files the files to write
+/// @throws std::filesystem::filesystem_error for the first file that
+///   could not be written, after every other file has been written
+///   and closed
+/// @throws std::system_error if io_uring is not @c available
+///
+void write_files(std::span<const file_write> files);
+
+/// @brief Copy a batch of files.
+///
+/// The sources are opened and their sizes read in one submission, the
+/// copies created in a second and every file closed in a third.  The
+/// data is transferred as by @c copy_file, which needs no more than
+/// one or two system calls for a small file.
+///
+/// @param files the files to copy; the copies must not already exist
+/// @throws std::filesystem::filesystem_error for the first file that
+///   could not be copied, after the others have been copied
+/// @throws std::system_error if io_uring is not @c available
+///
+void copy_files(std::span<const file_copy> files);
+
+} // namespace epub::uring
+
+#endif
@@ -0,0 +1,106 @@
+#ifndef _worker_pool_hpp_
+#define _worker_pool_hpp_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace epub {
+
+/// @brief A fixed-size pool of worker threads.
+///
+/// Tasks are run in submission order by whichever worker is free.
+/// Results (and exceptions) are delivered through @c std::future
+/// objects so that callers can consume them in a deterministic order
+/// regardless of the order in which they complete.
+///
+class worker_pool {
+    std::vector<std::thread> _threads;
+    std::deque<std::function<void()>> _queue;
+    std::mutex _mutex;
+    std::condition_variable _ready;
+    bool _stopping = false;
+
+    void run() {
+        for (;;) {
+            std::function<void()> task;
+
+            {
+                std::unique_lock lock{_mutex};
+                _ready.wait(lock,
+                            [this] { return _stopping || !_queue.empty(); });
+                if (_queue.empty()) return;
+                task = std::move(_queue.front());
+                _queue.pop_front();
+            }
+
+            task();
+        }
+    }
+
+  public:
+    /// @brief Start the workers.
+    ///
+    /// @param threads the number of workers; zero selects the number
+    ///   of hardware threads
+    ///
+    explicit worker_pool(unsigned threads) {
+        if (threads == 0) threads = std::thread::hardware_concurrency();
+        if (threads == 0) threads = 1;
+
+        _threads.reserve(threads);
+        for (unsigned i = 0; i < threads; ++i) {
+            _threads.emplace_back(&worker_pool::run, this);
+        }
+    }
+
+    worker_pool(const worker_pool &) = delete;
+    worker_pool &operator=(const worker_pool &) = delete;
+
+    /// @brief Finish all queued tasks and stop the workers.
+    ~worker_pool() {
+        {
+            std::lock_guard lock{_mutex};
+            _stopping = true;
+        }
+        _ready.notify_all();
+        for (auto &&thread : _threads) thread.join();
+    }
+
+    /// @brief The number of workers.
+    auto size() const {
+        return _threads.size();
+    }
+
+    /// @brief Queue a task.
+    ///
+    /// @param fn a callable taking no arguments
+    /// @returns a future for the result of @p fn
+    ///
+    template <class Fn>
+    auto submit(Fn &&fn) {
+        using result_type = std::invoke_result_t<std::decay_t<Fn>>;
+
+        auto task = std::make_shared<std::packaged_task<result_type()>>(
+            std::forward<Fn>(fn));
+        auto future = task->get_future();
+
+        {
+            std::lock_guard lock{_mutex};
+            _queue.emplace_back([task] { (*task)(); });
+        }
+        _ready.notify_one();
+
+        return future;
+    }
+};
+
+} // namespace epub
+
+#endif
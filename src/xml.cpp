@@ -4,12 +4,17 @@
 #include "minidom.hpp"
 #include "package.hpp"
 #include "uri.hpp"
+#include "xml_writer.hpp"
 
+#include <fstream>
+#include <optional>
 #include <sstream>
+#include <utility>
+#include <vector>
 
 namespace epub::xml {
 
-static inline node_ptr add_refinement(node_ptr parent,
+static inline node_ref add_refinement(node_ref parent,
                                       const std::u8string &id,
                                       const std::u8string &property,
                                       const std::u8string &content) {
@@ -19,7 +24,7 @@ static inline node_ptr add_refinement(node_ptr parent,
     return meta;
 };
 
-static inline node_ptr add_refinement(node_ptr parent,
+static inline node_ref add_refinement(node_ref parent,
                                       const std::u8string &id,
                                       const std::u8string &property,
                                       const std::u8string &content,
@@ -29,37 +34,39 @@ static inline node_ptr add_refinement(node_ptr parent,
     return meta;
 };
 
-void write_metadata(node_ptr metadata_node, const class metadata &m) {
+static std::u8string modified_timestamp() {
+    time_t now = std::chrono::system_clock::to_time_t(timestamp());
+    struct tm tm;
+    gmtime_r(&now, &tm);
+
+    std::ostringstream os;
+    os << std::put_time(&tm, "%FT%TZ");
+    std::string fmt = std::move(os).str();
+
+    return {fmt.begin(), fmt.end()};
+}
+
+void write_metadata(node_ref metadata_node, const class metadata &m) {
     auto dc_ns = new_ns(metadata_node, dc_ns_uri, u8"dc");
 
     auto identifier = new_child_node(metadata_node, dc_ns, u8"identifier",
                                      m.identifier());
-    auto title = new_child_node(metadata_node, dc_ns, u8"title", m.title());
-    auto language =
-        new_child_node(metadata_node, dc_ns, u8"language", m.language());
+    new_child_node(metadata_node, dc_ns, u8"title", m.title());
+    new_child_node(metadata_node, dc_ns, u8"language", m.language());
 
     set_attribute(identifier, u8"id", u8"pub-id");
 
     if (!m.description().empty()) {
         auto description =
             new_child_node(metadata_node, dc_ns, u8"description");
-        auto cdata = new_cdata_child(description, m.description());
+        new_cdata_child(description, m.description());
     }
 
     // The dcterms::modified meta property is always the current time.
 
     {
-        time_t now = time(0);
-        struct tm tm;
-        gmtime_r(&now, &tm);
-
-        std::ostringstream os;
-        os << std::put_time(&tm, "%FT%TZ");
-        std::string fmt = std::move(os).str();
-        auto timestamp = reinterpret_cast<const char8_t *>(fmt.c_str());
-
-        auto modified =
-            new_child_node(metadata_node, nullptr, u8"meta", timestamp);
+        auto modified = new_child_node(metadata_node, nullptr, u8"meta",
+                                       modified_timestamp());
         set_attribute(modified, u8"property", u8"dcterms:modified");
     }
 
@@ -131,7 +138,7 @@ void write_metadata(node_ptr metadata_node, const class metadata &m) {
 }
 
 template <class Manifest>
-void write_manifest(node_ptr manifest_node, Manifest &&manifest) {
+void write_manifest(node_ref manifest_node, Manifest &&manifest) {
     for (auto &&item : std::forward<Manifest>(manifest)) {
         auto node = new_child_node(manifest_node, nullptr, u8"item");
 
@@ -147,7 +154,7 @@ void write_manifest(node_ptr manifest_node, Manifest &&manifest) {
 }
 
 template <class Spine>
-void write_spine(node_ptr spine_node, Spine &&spine) {
+void write_spine(node_ref spine_node, Spine &&spine) {
     for (auto &&itemref : std::forward<Spine>(spine)) {
         auto node = new_child_node(spine_node, nullptr, u8"itemref");
         set_attribute(node, u8"idref", itemref.id);
@@ -157,11 +164,10 @@ void write_spine(node_ptr spine_node, Spine &&spine) {
     }
 }
 
-void write_package(const std::filesystem::path &path, const package &p) {
+static doc_ptr package_doc(const package &p) {
     auto doc = new_doc(u8"1.0");
 
-    auto root = new_node(doc, nullptr, u8"package");
-    set_root_element(doc, root);
+    auto root = new_root_element(doc, u8"package");
 
     auto opf_ns = new_ns(root, opf_ns_uri);
     set_ns(root, opf_ns);
@@ -183,17 +189,189 @@ void write_package(const std::filesystem::path &path, const package &p) {
                   u8"http://vocabulary.itunes.apple.com/rdf/ibooks/"
                   u8"vocabulary-extensions-1.0/");
 
-    save_file(path, doc, 1);
+    return doc;
+}
+
+// The streaming serializers below produce the same documents as the
+// DOM-based ones above without holding a tree of the whole document.
+
+static void stream_refinement(stream_writer &w, const std::u8string &id,
+                              std::u8string_view property,
+                              std::u8string_view content,
+                              std::u8string_view scheme = {}) {
+    w.start(u8"meta");
+    w.attribute(u8"refines", u8'#' + id);
+    w.attribute(u8"property", property);
+    if (!scheme.empty()) w.attribute(u8"scheme", scheme);
+    w.text(content);
+    w.end();
+}
+
+static void stream_meta(stream_writer &w, std::u8string_view property,
+                        std::u8string_view content) {
+    w.start(u8"meta");
+    w.attribute(u8"property", property);
+    w.text(content);
+    w.end();
+}
+
+static void stream_metadata(stream_writer &w, const class metadata &m) {
+    w.start(u8"metadata");
+    w.attribute(u8"xmlns:dc", dc_ns_uri);
+
+    w.start(u8"dc:identifier");
+    w.attribute(u8"id", u8"pub-id");
+    w.text(m.identifier());
+    w.end();
+
+    w.text_element(u8"dc:title", m.title());
+    w.text_element(u8"dc:language", m.language());
+
+    if (!m.description().empty()) {
+        w.start(u8"dc:description");
+        w.cdata(m.description());
+        w.end();
+    }
+
+    stream_meta(w, u8"dcterms:modified", modified_timestamp());
+
+    for (auto &&creator : m.creators()) {
+        const auto &role = creator.role();
+        const auto &file_as = creator.file_as();
+
+        std::u8string id;
+        if (!role.empty() || !file_as.empty()) id = generate_id();
+
+        w.start(u8"dc:creator");
+        if (!id.empty()) w.attribute(u8"id", id);
+        w.text(static_cast<const std::u8string &>(creator));
+        w.end();
+
+        if (!role.empty()) {
+            stream_refinement(w, id, u8"role", role, u8"marc:relators");
+        }
+        if (!file_as.empty()) {
+            stream_refinement(w, id, u8"file-as", file_as);
+        }
+    }
+
+    for (auto &&collection : m.collections()) {
+        const auto type = collection.type();
+        const auto position = collection.group_position();
+
+        std::u8string id;
+        if (type != collection::type::unspecified || !position.empty()) {
+            id = generate_id();
+        }
+
+        w.start(u8"meta");
+        w.attribute(u8"property", u8"belongs-to-collection");
+        if (!id.empty()) w.attribute(u8"id", id);
+        w.text(static_cast<const std::u8string &>(collection));
+        w.end();
+
+        switch (type) {
+            case collection::type::unspecified:
+                break;
+            case collection::type::series:
+                stream_refinement(w, id, u8"collection-type", u8"series");
+                break;
+            case collection::type::set:
+                stream_refinement(w, id, u8"collection-type", u8"set");
+                break;
+        }
+
+        if (!position.empty()) {
+            stream_refinement(w, id, u8"group-position", position);
+        }
+    }
+
+    stream_meta(w, u8"rendition:layout", m.layout());
+
+    if (m.orientation() != u8"auto") {
+        stream_meta(w, u8"rendition:orientation", m.orientation());
+    }
+
+    stream_meta(w, u8"ibooks:specified-fonts", u8"true");
+
+    w.end();
 }
 
+static void stream_package(std::ostream &out, const package &p) {
+    stream_writer w{out};
+
+    w.start(u8"package");
+    w.attribute(u8"xmlns", opf_ns_uri);
+    w.attribute(u8"version", u8"3.0");
+    w.attribute(u8"unique-identifier", u8"pub-id");
+    w.attribute(u8"prefix",
+                u8"ibooks: "
+                u8"http://vocabulary.itunes.apple.com/rdf/ibooks/"
+                u8"vocabulary-extensions-1.0/");
+
+    stream_metadata(w, p.metadata());
+
+    w.start(u8"manifest");
+    for (auto &&item : p.manifest()) {
+        w.start(u8"item");
+        w.attribute(u8"id", item.id);
+        w.attribute(u8"href", uri_encoding(item.path.u8string()));
+        w.attribute(u8"media-type", item.metadata.at(u8"media-type"));
+        if (!item.properties.empty()) {
+            w.attribute(u8"properties", item.properties);
+        }
+        w.end();
+    }
+    w.end();
+
+    w.start(u8"spine");
+    for (auto &&itemref : p.spine()) {
+        w.start(u8"itemref");
+        w.attribute(u8"idref", itemref.id);
+        if (!itemref.spine_properties.empty()) {
+            w.attribute(u8"properties", itemref.spine_properties);
+        }
+        w.end();
+    }
+    w.end();
+
+    w.end();
+}
+
+void write_package(const std::filesystem::path &path, const package &p) {
+    std::ofstream out{path, std::ios::binary};
+    stream_package(out, p);
+
+    if (!out.flush()) {
+        throw std::filesystem::filesystem_error("unable to write", path,
+                                                std::io_errc::stream);
+    }
+}
+
+void package_document(std::ostream &out, const package &p) {
+    stream_package(out, p);
+}
+
+std::string package_document(const package &p) {
+    std::ostringstream out;
+    stream_package(out, p);
+    return std::move(out).str();
+}
+
+namespace dom {
+
+std::string package_document(const package &p) {
+    return save_string(package_doc(p), 1);
+}
+
+} // namespace dom
+
 template <class Navigation>
-void write_navigation(const std::filesystem::path &path,
-                      Navigation &&navigation,
-                      const std::filesystem::path &ss) {
+static doc_ptr navigation_doc(Navigation &&navigation,
+                              const std::filesystem::path &ss) {
     auto doc = new_doc(u8"1.0");
 
-    auto html = new_node(doc, nullptr, u8"html");
-    set_root_element(doc, html);
+    auto html = new_root_element(doc, u8"html");
 
     auto h_ns = new_ns(html, xhtml_ns_uri);
     set_ns(html, h_ns);
@@ -229,21 +407,76 @@ void write_navigation(const std::filesystem::path &path,
         set_attribute(a, u8"href", href);
     }
 
-    save_file(path, doc, 1);
+    return doc;
 }
 
-void write_container(const std::filesystem::path &path,
-                     const container &container) {
-    auto meta_inf_dir = path / "META-INF";
-    create_directory(meta_inf_dir);
+void navigation_document(std::ostream &out, const container &container) {
+    stream_writer w{out};
+
+    w.start(u8"html");
+    w.attribute(u8"xmlns", xhtml_ns_uri);
+
+    w.start(u8"head");
+    w.text_element(u8"title", u8"Table of Contents");
+
+    if (const auto &ss = container.toc_stylesheet(); !ss.empty()) {
+        w.start(u8"link");
+        w.attribute(u8"rel", u8"stylesheet");
+        w.attribute(u8"type", u8"text/css");
+        w.attribute(u8"href", uri_encoding(ss.u8string()));
+        w.end();
+    }
+
+    w.end();
+
+    w.start(u8"body");
+    w.attribute(u8"xmlns:epub", ops_ns_uri);
+    w.attribute(u8"class", u8"navigation");
+
+    w.text_element(u8"h1", u8"Table of Contents");
+
+    w.start(u8"nav");
+    w.attribute(u8"epub:type", u8"toc");
+    w.start(u8"ol");
+
+    for (auto &&item : container.navigation()) {
+        w.start(u8"li");
+        w.start(u8"a");
+        w.attribute(u8"href", uri_encoding(item.path.u8string()));
+        w.text(item.metadata.at(u8"title"));
+        w.end();
+        w.end();
+    }
 
+    w.end();
+    w.end();
+    w.end();
+    w.end();
+}
+
+std::string navigation_document(const container &container) {
+    std::ostringstream out;
+    navigation_document(out, container);
+    return std::move(out).str();
+}
+
+namespace dom {
+
+std::string navigation_document(const container &container) {
+    return save_string(
+        navigation_doc(container.navigation(), container.toc_stylesheet()),
+        1);
+}
+
+} // namespace dom
+
+std::string container_document() {
     auto doc = new_doc(u8"1.0");
-    auto root = new_node(doc, nullptr, u8"container");
+    auto root = new_root_element(doc, u8"container");
     auto ns = new_ns(root, odc_ns_uri);
 
     set_ns(root, ns);
     set_attribute(root, u8"version", u8"1.0");
-    set_root_element(doc, root);
 
     auto rootfiles = new_child_node(root, ns, u8"rootfiles");
     auto rootfile = new_child_node(rootfiles, ns, u8"rootfile");
@@ -251,19 +484,59 @@ void write_container(const std::filesystem::path &path,
     set_attribute(rootfile, u8"media-type",
                   u8"application/oebps-package+xml");
 
-    save_file(meta_inf_dir / "container.xml", doc, 1);
+    return save_string(doc, 1);
+}
+
+// Only the head is read; parsing stops at its end tag (or at the first
+// other child of the root), so the body is never parsed.
+
+void get_xhtml_metadata(const std::filesystem::path &path,
+                        file_metadata &metadata) {
+    auto r = reader::open(path);
+
+    auto is_xhtml = [&r](const std::u8string &name) {
+        return reader::local_name(r) == name &&
+               reader::namespace_uri(r) == xhtml_ns_uri;
+    };
+
+    std::optional<std::u8string> title;
+    std::vector<std::pair<std::u8string, std::u8string>> meta;
 
-    auto contents_dir = path / "Contents";
-    create_directory(contents_dir);
+    while (reader::read(r)) {
+        auto t = reader::type(r);
+        auto d = reader::depth(r);
 
-    write_package(contents_dir / "package.opf", container.package());
+        if (t == reader::node_type::end_element && d == 1) break;
+        if (t != reader::node_type::element) continue;
 
-    write_navigation(contents_dir / "nav.xhtml", container.navigation(),
-                     container.toc_stylesheet());
+        if (d == 0) {
+            if (!is_xhtml(u8"html")) break;
+        }
+        else if (d == 1) {
+            if (!is_xhtml(u8"head") || reader::is_empty_element(r)) break;
+        }
+        else if (d == 2) {
+            if (!title && is_xhtml(u8"title")) {
+                title = reader::read_string(r);
+            }
+            else if (is_xhtml(u8"meta")) {
+                auto name = reader::get_attribute(r, u8"name");
+                if (!name.starts_with(u8"epub:")) continue;
+                meta.emplace_back(std::move(name).substr(5),
+                                  reader::get_attribute(r, u8"content"));
+            }
+        }
+    }
+
+    metadata[u8"title"] = title.value_or(std::u8string{});
+
+    for (auto &&[name, content] : meta) {
+        metadata[std::move(name)] = std::move(content);
+    }
 }
 
-void get_xhtml_metadata(const std::filesystem::path &path,
-                        file_metadata &metadata) {
+void dom::get_xhtml_metadata(const std::filesystem::path &path,
+                             file_metadata &metadata) {
     auto doc = read_file(path);
     auto ctx = xpath::new_context(doc);
 
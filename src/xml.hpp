@@ -4,6 +4,8 @@
 #include "file_metadata.hpp"
 
 #include <filesystem>
+#include <iosfwd>
+#include <string>
 
 namespace epub {
 
@@ -23,8 +25,49 @@ constexpr auto xhtml_ns_uri = u8"http://www.w3.org/1999/xhtml";
 extern void write_package(const std::filesystem::path &path,
                           const package &package);
 
-extern void write_container(const std::filesystem::path &path,
-                            const container &container);
+/// @brief Write the package document.
+///
+/// The document is written as it is generated, so only the nesting of
+/// its elements is held in memory.
+///
+/// @param out the destination
+/// @param package the package to describe
+///
+extern void package_document(std::ostream &out, const package &package);
+
+extern std::string package_document(const package &package);
+
+/// @brief Write the navigation document.
+///
+/// As with @c package_document, the document is written as it is
+/// generated.
+///
+/// @param out the destination
+/// @param container the container whose navigation is listed
+///
+extern void navigation_document(std::ostream &out,
+                                const container &container);
+
+extern std::string navigation_document(const container &container);
+
+/// @brief Serializers and readers that build a libxml2 tree of the
+/// document.
+///
+/// These are the reference for the streaming versions, which must
+/// produce the same results.
+///
+namespace dom {
+
+extern std::string package_document(const package &package);
+
+extern std::string navigation_document(const container &container);
+
+extern void get_xhtml_metadata(const std::filesystem::path &path,
+                               file_metadata &metadata);
+
+} // namespace dom
+
+extern std::string container_document();
 
 extern void get_xhtml_metadata(const std::filesystem::path &path,
                                file_metadata &metadata);
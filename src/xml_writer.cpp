@@ -0,0 +1,237 @@
+#include "xml_writer.hpp"
+
+#include <iterator>
+#include <stdexcept>
+
+namespace epub::xml {
+
+namespace {
+
+/// Decode the UTF-8 sequence starting at @p p, advancing @p p past it.
+char32_t decode(std::u8string_view::const_iterator &p,
+                std::u8string_view::const_iterator end) {
+    char32_t ch = static_cast<unsigned char>(*p++);
+
+    int extra = ch >= 0xf0 ? 3 : ch >= 0xe0 ? 2 : ch >= 0xc0 ? 1 : 0;
+    if (extra > 0) ch &= 0x3f >> extra;
+
+    for (; extra > 0 && p != end; --extra) {
+        ch = (ch << 6) | (static_cast<unsigned char>(*p++) & 0x3f);
+    }
+
+    return ch;
+}
+
+/// Adapts a string to the subset of @c std::ostream used below.
+struct string_sink {
+    std::string &s;
+
+    string_sink &operator<<(std::string_view v) {
+        s += v;
+        return *this;
+    }
+    string_sink &operator<<(char ch) {
+        s += ch;
+        return *this;
+    }
+};
+
+template <class Out>
+void char_ref(Out &out, char32_t ch) {
+    char digits[8];
+    auto p = std::end(digits);
+
+    do {
+        *--p = "0123456789ABCDEF"[ch & 0xf];
+        ch >>= 4;
+    } while (ch != 0);
+
+    out << "&#x" << std::string_view(p, std::end(digits)) << ';';
+}
+
+// These mirror libxml2's escaping of text and attribute values when
+// no output encoding is declared.
+
+template <class Out>
+void escape_text(Out &out, std::u8string_view text) {
+    for (auto p = text.begin(); p != text.end();) {
+        if (static_cast<unsigned char>(*p) >= 0x80) {
+            char_ref(out, decode(p, text.end()));
+            continue;
+        }
+
+        switch (char ch = static_cast<char>(*p++)) {
+            case '&':
+                out << "&amp;";
+                break;
+            case '<':
+                out << "&lt;";
+                break;
+            case '>':
+                out << "&gt;";
+                break;
+            case '\r':
+                out << "&#xD;";
+                break;
+            default:
+                out << ch;
+        }
+    }
+}
+
+template <class Out>
+void escape_attribute(Out &out, std::u8string_view value) {
+    for (auto p = value.begin(); p != value.end();) {
+        if (static_cast<unsigned char>(*p) >= 0x80) {
+            char_ref(out, decode(p, value.end()));
+            continue;
+        }
+
+        switch (char ch = static_cast<char>(*p++)) {
+            case '&':
+                out << "&amp;";
+                break;
+            case '<':
+                out << "&lt;";
+                break;
+            case '>':
+                out << "&gt;";
+                break;
+            case '"':
+                out << "&quot;";
+                break;
+            case '\t':
+                out << "&#9;";
+                break;
+            case '\n':
+                out << "&#10;";
+                break;
+            case '\r':
+                out << "&#13;";
+                break;
+            default:
+                out << ch;
+        }
+    }
+}
+
+std::string_view bytes(std::u8string_view s) {
+    return {reinterpret_cast<const char *>(s.data()), s.size()};
+}
+
+template <class Out>
+void write_cdata(Out &out, std::u8string_view content) {
+    // A CDATA section cannot contain "]]>", so split it after the
+    // brackets as libxml2 does.
+    for (;;) {
+        auto end = content.find(u8"]]>");
+        auto part = content.substr(0, end == content.npos ? end : end + 2);
+        out << "<![CDATA[" << bytes(part) << "]]>";
+        if (end == content.npos) break;
+
+        content.remove_prefix(end + 2);
+    }
+}
+
+} // namespace
+
+void escape_text(std::string &out, std::u8string_view text) {
+    string_sink sink{out};
+    escape_text(sink, text);
+}
+
+void escape_attribute(std::string &out, std::u8string_view value) {
+    string_sink sink{out};
+    escape_attribute(sink, value);
+}
+
+void write_cdata(std::string &out, std::u8string_view content) {
+    string_sink sink{out};
+    write_cdata(sink, content);
+}
+
+stream_writer::stream_writer(std::ostream &out)
+    : _out(out) {
+    _out << "<?xml version=\"1.0\"?>\n";
+}
+
+void stream_writer::close_start_tag() {
+    if (!_in_start_tag) return;
+
+    _out << ">\n";
+    _in_start_tag = false;
+}
+
+void stream_writer::indent() {
+    for (auto i = _open.size(); i > 0; --i) _out << "  ";
+}
+
+void stream_writer::start(std::u8string_view name) {
+    if (!_open.empty()) {
+        if (_open.back().has_content) {
+            throw std::logic_error{"xml::stream_writer: mixed content"};
+        }
+        close_start_tag();
+    }
+
+    indent();
+    _out << '<' << bytes(name);
+
+    _open.push_back({.name = std::u8string{name}});
+    _in_start_tag = true;
+}
+
+void stream_writer::attribute(std::u8string_view name,
+                              std::u8string_view value) {
+    if (!_in_start_tag) {
+        throw std::logic_error{"xml::stream_writer: late attribute"};
+    }
+
+    _out << ' ' << bytes(name) << "=\"";
+    escape_attribute(_out, value);
+    _out << '"';
+}
+
+void stream_writer::text(std::u8string_view content) {
+    if (!_in_start_tag) {
+        throw std::logic_error{"xml::stream_writer: mixed content"};
+    }
+
+    _out << '>';
+    escape_text(_out, content);
+
+    _in_start_tag = false;
+    _open.back().has_content = true;
+}
+
+void stream_writer::cdata(std::u8string_view content) {
+    if (!_in_start_tag) {
+        throw std::logic_error{"xml::stream_writer: mixed content"};
+    }
+
+    _out << '>';
+    write_cdata(_out, content);
+
+    _in_start_tag = false;
+    _open.back().has_content = true;
+}
+
+void stream_writer::end() {
+    if (_open.empty()) {
+        throw std::logic_error{"xml::stream_writer: no open element"};
+    }
+
+    auto e = std::move(_open.back());
+    _open.pop_back();
+
+    if (_in_start_tag) {
+        _out << "/>\n";
+        _in_start_tag = false;
+        return;
+    }
+
+    if (!e.has_content) indent();
+    _out << "</" << bytes(e.name) << ">\n";
+}
+
+} // namespace epub::xml
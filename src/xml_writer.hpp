@@ -0,0 +1,106 @@
+#ifndef _xml_writer_hpp_
+#define _xml_writer_hpp_
+
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace epub::xml {
+
+/// @brief A forward-only XML serializer.
+///
+/// Writes elements to a stream as they are started and ended, so the
+/// memory used depends only on the nesting depth.  The output is laid
+/// out and escaped exactly as libxml2 formats a document without a
+/// declared encoding: children are indented by two spaces, elements
+/// with text content are kept on one line, empty elements are
+/// self-closed, and characters outside ASCII are written as character
+/// references.
+///
+/// An element may contain either elements or a single text or CDATA
+/// node; mixed content is not supported.
+///
+class stream_writer {
+    struct element {
+        std::u8string name;
+        bool has_content = false;
+    };
+
+    std::ostream &_out;
+    std::vector<element> _open;
+    bool _in_start_tag = false;
+
+    void close_start_tag();
+    void indent();
+
+  public:
+    /// @brief Start a document.
+    ///
+    /// Writes the XML declaration.
+    ///
+    /// @param out the destination
+    ///
+    explicit stream_writer(std::ostream &out);
+
+    stream_writer(const stream_writer &) = delete;
+    stream_writer &operator=(const stream_writer &) = delete;
+
+    /// @brief Start an element.
+    ///
+    /// @param name the qualified name of the element
+    ///
+    void start(std::u8string_view name);
+
+    /// @brief Add an attribute to the element just started.
+    ///
+    /// Namespace declarations are written as ordinary attributes and
+    /// should precede the others.
+    ///
+    /// @param name the qualified name of the attribute
+    /// @param value the unescaped value
+    ///
+    void attribute(std::u8string_view name, std::u8string_view value);
+
+    /// @brief Set the content of the element just started.
+    ///
+    /// @param content the unescaped character data
+    ///
+    void text(std::u8string_view content);
+
+    /// @brief Set the content of the element just started as a CDATA
+    /// section.
+    ///
+    /// @param content the character data
+    ///
+    void cdata(std::u8string_view content);
+
+    /// @brief End the innermost open element.
+    void end();
+
+    /// @brief Write an element containing only character data.
+    ///
+    /// @param name the qualified name of the element
+    /// @param content the unescaped character data
+    ///
+    void text_element(std::u8string_view name, std::u8string_view content) {
+        start(name);
+        text(content);
+        end();
+    }
+};
+
+/// @brief Append character data escaped as by @c stream_writer::text.
+void escape_text(std::string &out, std::u8string_view text);
+
+/// @brief Append an attribute value escaped as by
+/// @c stream_writer::attribute.
+void escape_attribute(std::string &out, std::u8string_view value);
+
+/// @brief Append character data as one or more CDATA sections, as
+/// written by @c stream_writer::cdata.
+void write_cdata(std::string &out, std::u8string_view content);
+
+} // namespace epub::xml
+
+#endif
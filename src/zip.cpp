@@ -0,0 +1,641 @@
+#include "zip.hpp"
+
+#include "metadata.hpp"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+#include <streambuf>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace epub::zip {
+
+namespace {
+
+constexpr std::uint32_t local_header_sig = 0x04034b50;
+constexpr std::uint32_t central_header_sig = 0x02014b50;
+constexpr std::uint32_t zip64_end_sig = 0x06064b50;
+constexpr std::uint32_t zip64_locator_sig = 0x07064b50;
+constexpr std::uint32_t end_sig = 0x06054b50;
+
+constexpr std::uint16_t zip64_extra_id = 0x0001;
+constexpr std::uint16_t utf8_flag = 0x0800;
+
+constexpr std::uint16_t version_default = 20;
+constexpr std::uint16_t version_zip64 = 45;
+constexpr std::uint16_t made_by_unix = 3 << 8;
+
+constexpr std::uint32_t max32 = std::numeric_limits<std::uint32_t>::max();
+constexpr std::uint16_t max16 = std::numeric_limits<std::uint16_t>::max();
+
+void put16(std::string &buf, std::uint16_t v) {
+    buf += static_cast<char>(v & 0xff);
+    buf += static_cast<char>(v >> 8);
+}
+
+void put32(std::string &buf, std::uint32_t v) {
+    put16(buf, static_cast<std::uint16_t>(v & 0xffff));
+    put16(buf, static_cast<std::uint16_t>(v >> 16));
+}
+
+void put64(std::string &buf, std::uint64_t v) {
+    put32(buf, static_cast<std::uint32_t>(v & 0xffffffff));
+    put32(buf, static_cast<std::uint32_t>(v >> 32));
+}
+
+std::uint16_t get16(std::string_view buf, std::size_t pos) {
+    auto b = reinterpret_cast<const unsigned char *>(buf.data() + pos);
+    return static_cast<std::uint16_t>(b[0] | (b[1] << 8));
+}
+
+std::uint32_t get32(std::string_view buf, std::size_t pos) {
+    return get16(buf, pos) |
+           (static_cast<std::uint32_t>(get16(buf, pos + 2)) << 16);
+}
+
+std::uint64_t get64(std::string_view buf, std::size_t pos) {
+    return get32(buf, pos) |
+           (static_cast<std::uint64_t>(get32(buf, pos + 4)) << 32);
+}
+
+std::uint32_t clamp32(std::uint64_t v) {
+    return v >= max32 ? max32 : static_cast<std::uint32_t>(v);
+}
+
+std::uint16_t flags_for(const std::string &name) {
+    for (unsigned char ch : name) {
+        if (ch >= 0x80) return utf8_flag;
+    }
+    return 0;
+}
+
+std::uint32_t crc32_of(std::string_view data) {
+    uLong crc = crc32(0L, Z_NULL, 0);
+
+    while (!data.empty()) {
+        auto n = static_cast<uInt>(std::min<std::size_t>(
+            data.size(), std::numeric_limits<uInt>::max()));
+        crc = crc32(crc, reinterpret_cast<const Bytef *>(data.data()), n);
+        data.remove_prefix(n);
+    }
+
+    return static_cast<std::uint32_t>(crc);
+}
+
+std::string deflate_raw(std::string_view data, int level) {
+    z_stream zs{};
+
+    // Negative window bits produce a raw DEFLATE stream with no zlib
+    // header or trailer, as required by the ZIP format.
+    if (deflateInit2(&zs, level, Z_DEFLATED, -MAX_WBITS, 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK) {
+        throw std::runtime_error{"deflateInit2: " +
+                                 std::string{zs.msg ? zs.msg : "failed"}};
+    }
+
+    std::string result(deflateBound(&zs, data.size()), '\0');
+
+    zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.data()));
+    zs.avail_in = static_cast<uInt>(data.size());
+    zs.next_out = reinterpret_cast<Bytef *>(result.data());
+    zs.avail_out = static_cast<uInt>(result.size());
+
+    auto status = deflate(&zs, Z_FINISH);
+    result.resize(zs.total_out);
+    deflateEnd(&zs);
+
+    if (status != Z_STREAM_END) {
+        throw std::runtime_error{"deflate: incomplete stream"};
+    }
+
+    return result;
+}
+
+/// Deflates, or stores, what is written to it, handing the result to
+/// @c sink a buffer at a time.
+class deflate_buf : public std::streambuf {
+    std::function<void(std::string_view)> _sink;
+    bool _store;
+    z_stream _zs{};
+    std::vector<char> _in = std::vector<char>(64 * 1024);
+    std::vector<char> _out = std::vector<char>(64 * 1024);
+
+    void process(int flush) {
+        auto n = static_cast<std::size_t>(pptr() - pbase());
+        auto data = reinterpret_cast<Bytef *>(pbase());
+
+        crc = static_cast<std::uint32_t>(
+            crc32(crc, data, static_cast<uInt>(n)));
+        size += n;
+
+        if (_store) {
+            if (n > 0) _sink({pbase(), n});
+        }
+        else {
+            _zs.next_in = data;
+            _zs.avail_in = static_cast<uInt>(n);
+
+            int status;
+            do {
+                _zs.next_out = reinterpret_cast<Bytef *>(_out.data());
+                _zs.avail_out = static_cast<uInt>(_out.size());
+
+                status = deflate(&_zs, flush);
+                if (status == Z_STREAM_ERROR) {
+                    throw std::runtime_error{"deflate: stream error"};
+                }
+
+                auto produced = _out.size() - _zs.avail_out;
+                if (produced > 0) _sink({_out.data(), produced});
+            } while (_zs.avail_out == 0 ||
+                     (flush == Z_FINISH && status != Z_STREAM_END));
+        }
+
+        setp(_in.data(), _in.data() + _in.size());
+    }
+
+  protected:
+    int_type overflow(int_type ch) override {
+        process(Z_NO_FLUSH);
+        if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(ch);
+            pbump(1);
+        }
+        return traits_type::not_eof(ch);
+    }
+
+  public:
+    std::uint32_t crc = static_cast<std::uint32_t>(crc32(0L, Z_NULL, 0));
+    std::uint64_t size = 0;
+
+    deflate_buf(int level, std::function<void(std::string_view)> sink)
+        : _sink(std::move(sink))
+        , _store(level == 0) {
+        if (!_store && deflateInit2(&_zs, level, Z_DEFLATED, -MAX_WBITS, 8,
+                                    Z_DEFAULT_STRATEGY) != Z_OK) {
+            throw std::runtime_error{
+                "deflateInit2: " + std::string{_zs.msg ? _zs.msg : "failed"}};
+        }
+        setp(_in.data(), _in.data() + _in.size());
+    }
+
+    deflate_buf(const deflate_buf &) = delete;
+    deflate_buf &operator=(const deflate_buf &) = delete;
+
+    ~deflate_buf() override {
+        if (!_store) deflateEnd(&_zs);
+    }
+
+    /// Write what remains, ending the DEFLATE stream.
+    void finish() {
+        process(Z_FINISH);
+    }
+};
+
+} // namespace
+
+entry make_entry(std::string name, std::string_view contents, int level,
+                 unsigned min_savings) {
+    entry e = {
+        .name = std::move(name),
+        .crc = crc32_of(contents),
+        .size = contents.size(),
+    };
+
+    if (level > 0 && contents.size() <= std::numeric_limits<uInt>::max()) {
+        auto compressed = deflate_raw(contents, level);
+        auto saved = contents.size() - std::min(compressed.size(),
+                                                contents.size());
+        if (saved > 0 && saved * 100 >= contents.size() * min_savings) {
+            e.method = method::deflated;
+            e.data = std::move(compressed);
+            return e;
+        }
+    }
+
+    e.data.assign(contents);
+    return e;
+}
+
+writer::writer(const fs::path &path)
+    : _path(path)
+    , _temporary(fs::path{path} += ".tmp")
+    , _out(_temporary, std::ios::binary | std::ios::trunc) {
+    if (!_out) {
+        throw fs::filesystem_error("unable to create archive", _temporary,
+                                   std::io_errc::stream);
+    }
+
+    // All members share the time the archive was started so that the
+    // layout depends only on the contents.
+
+    using namespace std::chrono;
+
+    auto now = floor<seconds>(timestamp());
+    auto day = floor<days>(now);
+    year_month_day ymd{day};
+    hh_mm_ss hms{now - day};
+
+    auto year = static_cast<int>(ymd.year());
+    if (year < 1980) year = 1980;
+
+    _date = static_cast<std::uint16_t>(
+        ((year - 1980) << 9) | (static_cast<unsigned>(ymd.month()) << 5) |
+        static_cast<unsigned>(ymd.day()));
+    _time = static_cast<std::uint16_t>((hms.hours().count() << 11) |
+                                       (hms.minutes().count() << 5) |
+                                       (hms.seconds().count() / 2));
+}
+
+writer::~writer() {
+    if (_finished) return;
+
+    // An archive that was not closed is incomplete, usually because
+    // the build failed; it must not be mistaken for a finished one.
+    _out.close();
+    std::error_code ec;
+    fs::remove(_temporary, ec);
+}
+
+void writer::emit(std::string_view bytes) {
+    auto size = static_cast<std::streamsize>(bytes.size());
+    if (!_out.write(bytes.data(), size)) {
+        throw fs::filesystem_error("unable to write", _path,
+                                   std::io_errc::stream);
+    }
+    _offset += bytes.size();
+}
+
+void writer::add(const entry &e) {
+    if (_closed) throw std::logic_error{"zip::writer::add: closed"};
+    if (e.name.size() >= max16) {
+        throw std::invalid_argument{"zip::writer::add: name too long"};
+    }
+
+    _directory.push_back({
+        .name = e.name,
+        .method = e.method,
+        .crc = e.crc,
+        .size = e.size,
+        .compressed_size = e.data.size(),
+        .offset = _offset,
+    });
+
+    emit(local_header(_directory.back()));
+    emit(e.data);
+}
+
+void writer::add(const std::string &name, int level,
+                 const std::function<void(std::ostream &)> &generate) {
+    if (_closed) throw std::logic_error{"zip::writer::add: closed"};
+    if (name.size() >= max16) {
+        throw std::invalid_argument{"zip::writer::add: name too long"};
+    }
+
+    record r = {
+        .name = name,
+        .method = level > 0 ? method::deflated : method::stored,
+        .crc = 0,
+        .size = 0,
+        .compressed_size = 0,
+        .offset = _offset,
+    };
+
+    // The header is written with the sizes unknown and filled in once
+    // the data has been written after it.
+    auto header = local_header(r);
+    emit(header);
+
+    deflate_buf buf{level, [this](std::string_view bytes) { emit(bytes); }};
+    {
+        std::ostream out{&buf};
+        out.exceptions(std::ios::badbit);
+        generate(out);
+    }
+    buf.finish();
+
+    r.crc = buf.crc;
+    r.size = buf.size;
+    r.compressed_size = _offset - r.offset - header.size();
+
+    if (r.size >= max32 || r.compressed_size >= max32) {
+        throw fs::filesystem_error(
+            "member too large", _path,
+            std::make_error_code(std::errc::file_too_large));
+    }
+
+    std::string fields;
+    put32(fields, r.crc);
+    put32(fields, static_cast<std::uint32_t>(r.compressed_size));
+    put32(fields, static_cast<std::uint32_t>(r.size));
+
+    _out.seekp(static_cast<std::streamoff>(r.offset + 14));
+    _out.write(fields.data(), static_cast<std::streamsize>(fields.size()));
+    _out.seekp(0, std::ios::end);
+    if (!_out) {
+        throw fs::filesystem_error("unable to write", _path,
+                                   std::io_errc::stream);
+    }
+
+    _directory.push_back(std::move(r));
+}
+
+std::string writer::local_header(const record &r) const {
+    const bool zip64 = r.size >= max32 || r.compressed_size >= max32;
+
+    std::string header;
+
+    put32(header, local_header_sig);
+    put16(header, zip64 ? version_zip64 : version_default);
+    put16(header, flags_for(r.name));
+    put16(header, static_cast<std::uint16_t>(r.method));
+    put16(header, _time);
+    put16(header, _date);
+    put32(header, r.crc);
+    put32(header, zip64 ? max32
+                        : static_cast<std::uint32_t>(r.compressed_size));
+    put32(header, zip64 ? max32 : static_cast<std::uint32_t>(r.size));
+    put16(header, static_cast<std::uint16_t>(r.name.size()));
+    put16(header, zip64 ? 20 : 0);
+    header += r.name;
+
+    if (zip64) {
+        put16(header, zip64_extra_id);
+        put16(header, 16);
+        put64(header, r.size);
+        put64(header, r.compressed_size);
+    }
+
+    return header;
+}
+
+void writer::close() {
+    if (_closed) return;
+    _closed = true;
+
+    const std::uint64_t directory_offset = _offset;
+
+    std::string buf;
+
+    for (auto &&r : _directory) {
+        std::string extra;
+
+        if (r.size >= max32) put64(extra, r.size);
+        if (r.compressed_size >= max32) put64(extra, r.compressed_size);
+        if (r.offset >= max32) put64(extra, r.offset);
+
+        if (!extra.empty()) {
+            std::string field;
+            put16(field, zip64_extra_id);
+            put16(field, static_cast<std::uint16_t>(extra.size()));
+            extra = field + extra;
+        }
+
+        const auto version = extra.empty() ? version_default : version_zip64;
+
+        put32(buf, central_header_sig);
+        put16(buf, made_by_unix | version);
+        put16(buf, version);
+        put16(buf, flags_for(r.name));
+        put16(buf, static_cast<std::uint16_t>(r.method));
+        put16(buf, _time);
+        put16(buf, _date);
+        put32(buf, r.crc);
+        put32(buf, clamp32(r.compressed_size));
+        put32(buf, clamp32(r.size));
+        put16(buf, static_cast<std::uint16_t>(r.name.size()));
+        put16(buf, static_cast<std::uint16_t>(extra.size()));
+        put16(buf, 0); // comment length
+        put16(buf, 0); // disk number
+        put16(buf, 0); // internal attributes
+        put32(buf, 0100644U << 16); // external attributes: -rw-r--r--
+        put32(buf, clamp32(r.offset));
+        buf += r.name;
+        buf += extra;
+
+        if (buf.size() > 65536) {
+            emit(buf);
+            buf.clear();
+        }
+    }
+
+    emit(buf);
+    buf.clear();
+
+    const std::uint64_t directory_size = _offset - directory_offset;
+    const std::uint64_t count = _directory.size();
+
+    if (count >= max16 || directory_size >= max32 ||
+        directory_offset >= max32) {
+        const std::uint64_t zip64_end_offset = _offset;
+
+        put32(buf, zip64_end_sig);
+        put64(buf, 44); // size of the remaining record
+        put16(buf, made_by_unix | version_zip64);
+        put16(buf, version_zip64);
+        put32(buf, 0); // this disk
+        put32(buf, 0); // disk with the central directory
+        put64(buf, count);
+        put64(buf, count);
+        put64(buf, directory_size);
+        put64(buf, directory_offset);
+
+        put32(buf, zip64_locator_sig);
+        put32(buf, 0);
+        put64(buf, zip64_end_offset);
+        put32(buf, 1); // total disks
+    }
+
+    put32(buf, end_sig);
+    put16(buf, 0);
+    put16(buf, 0);
+    put16(buf, count >= max16 ? max16 : static_cast<std::uint16_t>(count));
+    put16(buf, count >= max16 ? max16 : static_cast<std::uint16_t>(count));
+    put32(buf, clamp32(directory_size));
+    put32(buf, clamp32(directory_offset));
+    put16(buf, 0); // comment length
+
+    emit(buf);
+
+    _out.close();
+    if (!_out) {
+        throw fs::filesystem_error("unable to write", _path,
+                                   std::io_errc::stream);
+    }
+
+    fs::rename(_temporary, _path);
+    _finished = true;
+}
+
+reader::reader(const fs::path &path)
+    : _path(path)
+    , _in(path, std::ios::binary) {
+    auto invalid = [&] {
+        return fs::filesystem_error(
+            "not a ZIP archive", _path,
+            std::make_error_code(std::errc::invalid_argument));
+    };
+
+    if (!_in) {
+        throw fs::filesystem_error("unable to open archive", path,
+                                   std::io_errc::stream);
+    }
+
+    const std::uint64_t file_size = fs::file_size(path);
+
+    // The end record is 22 bytes plus a comment of at most 64 KiB.
+    const auto tail_size = static_cast<std::size_t>(
+        std::min<std::uint64_t>(file_size, 22 + max16));
+    const std::uint64_t tail_offset = file_size - tail_size;
+    auto tail = read(tail_offset, tail_size);
+
+    std::size_t end = tail.size() < 22 ? tail.npos : tail.size() - 22;
+    while (end != tail.npos && get32(tail, end) != end_sig) {
+        end = end == 0 ? tail.npos : end - 1;
+    }
+    if (end == tail.npos) throw invalid();
+
+    std::uint64_t count = get16(tail, end + 10);
+    std::uint64_t directory_size = get32(tail, end + 12);
+    std::uint64_t directory_offset = get32(tail, end + 16);
+
+    if (count == max16 || directory_size == max32 ||
+        directory_offset == max32) {
+        if (end < 20 || get32(tail, end - 20) != zip64_locator_sig) {
+            throw invalid();
+        }
+
+        // The ZIP64 end record must lie before its locator.
+        const std::uint64_t locator = tail_offset + end - 20;
+        auto zip64_end_offset = get64(tail, end - 12);
+        if (zip64_end_offset > locator || locator - zip64_end_offset < 56) {
+            throw invalid();
+        }
+
+        auto zip64_end = read(zip64_end_offset, 56);
+        if (get32(zip64_end, 0) != zip64_end_sig) throw invalid();
+
+        count = get64(zip64_end, 32);
+        directory_size = get64(zip64_end, 40);
+        directory_offset = get64(zip64_end, 48);
+    }
+
+    if (directory_offset > file_size ||
+        directory_size > file_size - directory_offset) {
+        throw invalid();
+    }
+
+    auto directory =
+        read(directory_offset, static_cast<std::size_t>(directory_size));
+
+    for (std::size_t pos = 0; count > 0; --count) {
+        if (pos + 46 > directory.size() ||
+            get32(directory, pos) != central_header_sig) {
+            throw invalid();
+        }
+
+        auto name_size = get16(directory, pos + 28);
+        auto extra_size = get16(directory, pos + 30);
+        auto comment_size = get16(directory, pos + 32);
+
+        if (pos + 46 + name_size + extra_size + comment_size >
+            directory.size()) {
+            throw invalid();
+        }
+
+        record r = {
+            .method = static_cast<enum method>(get16(directory, pos + 10)),
+            .crc = get32(directory, pos + 16),
+            .size = get32(directory, pos + 24),
+            .compressed_size = get32(directory, pos + 20),
+            .offset = get32(directory, pos + 42),
+        };
+
+        auto name = directory.substr(pos + 46, name_size);
+
+        // The ZIP64 extra field holds, in order, those values that did
+        // not fit in the fixed part of the header.
+        for (auto extra = pos + 46 + name_size,
+                  extra_end = extra + extra_size;
+             extra + 4 <= extra_end;) {
+            auto id = get16(directory, extra);
+            auto size = get16(directory, extra + 2);
+            auto field = extra + 4;
+            auto field_end = field + size;
+
+            if (field_end > extra_end) throw invalid();
+
+            auto next64 = [&] {
+                if (field + 8 > field_end) throw invalid();
+                auto value = get64(directory, field);
+                field += 8;
+                return value;
+            };
+
+            if (id == zip64_extra_id) {
+                if (r.size == max32) r.size = next64();
+                if (r.compressed_size == max32) {
+                    r.compressed_size = next64();
+                }
+                if (r.offset == max32) r.offset = next64();
+            }
+
+            extra = field_end;
+        }
+
+        if (r.offset > file_size ||
+            r.compressed_size > file_size - r.offset) {
+            throw invalid();
+        }
+
+        _directory.emplace(std::move(name), r);
+        pos += 46 + name_size + extra_size + comment_size;
+    }
+}
+
+std::string reader::read(std::uint64_t offset, std::size_t size) {
+    std::string buf(size, '\0');
+
+    _in.seekg(static_cast<std::streamoff>(offset));
+    if (!_in.read(buf.data(), static_cast<std::streamsize>(size))) {
+        throw fs::filesystem_error("unable to read", _path,
+                                   std::io_errc::stream);
+    }
+
+    return buf;
+}
+
+std::optional<entry> reader::get(const std::string &name) {
+    auto found = _directory.find(name);
+    if (found == _directory.end()) return std::nullopt;
+
+    const auto &r = found->second;
+
+    auto header = read(r.offset, 30);
+    if (get32(header, 0) != local_header_sig) {
+        throw fs::filesystem_error(
+            "bad local header", _path,
+            std::make_error_code(std::errc::invalid_argument));
+    }
+
+    auto data_offset = r.offset + 30 + get16(header, 26) + get16(header, 28);
+    auto data_size = static_cast<std::size_t>(r.compressed_size);
+
+    return entry{
+        .name = name,
+        .method = r.method,
+        .crc = r.crc,
+        .size = r.size,
+        .data = read(data_offset, data_size),
+    };
+}
+
+} // namespace epub::zip
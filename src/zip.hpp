@@ -0,0 +1,182 @@
+#ifndef _zip_hpp_
+#define _zip_hpp_
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace epub::zip {
+
+/// @brief Compression methods understood by the archive writer.
+enum class method : std::uint16_t {
+    stored = 0,   ///< No compression.
+    deflated = 8, ///< Raw DEFLATE (RFC 1951) compression.
+};
+
+/// @brief An archive member ready to be written.
+///
+/// The @c data member holds the bytes exactly as they will appear in
+/// the archive; that is, after compression if @c method is
+/// @c method::deflated.
+///
+struct entry {
+    std::string name;                     ///< The path inside the archive.
+    enum method method = method::stored;  ///< How @c data is encoded.
+    std::uint32_t crc = 0;                ///< CRC-32 of the original data.
+    std::uint64_t size = 0;               ///< Length of the original data.
+    std::string data;                     ///< The encoded data.
+};
+
+/// @brief Prepare an archive member.
+///
+/// Compresses @p contents at the given zlib compression level.  A
+/// level of zero stores the data uncompressed.  As with Info-ZIP, the
+/// data is also stored when compression does not make it smaller, or
+/// when it saves less than @p min_savings percent of the original.
+///
+/// @param name the path inside the archive
+/// @param contents the uncompressed data
+/// @param level the compression level (0&ndash;9)
+/// @param min_savings the smallest worthwhile reduction in percent
+/// @returns an entry ready to be passed to @c writer::add
+///
+entry make_entry(std::string name, std::string_view contents, int level,
+                 unsigned min_savings = 0);
+
+/// @brief A sequential ZIP archive writer.
+///
+/// Members are written in the order they are added with their sizes
+/// and checksums in the local headers, so no data descriptors are
+/// used.  ZIP64 extensions are emitted only when an archive outgrows
+/// the classic format limits.
+///
+class writer {
+    struct record {
+        std::string name;
+        enum method method;
+        std::uint32_t crc;
+        std::uint64_t size;
+        std::uint64_t compressed_size;
+        std::uint64_t offset;
+    };
+
+    std::filesystem::path _path;
+    std::filesystem::path _temporary;
+    std::ofstream _out;
+    std::vector<record> _directory;
+    std::uint64_t _offset = 0;
+    std::uint16_t _time = 0;
+    std::uint16_t _date = 0;
+    bool _closed = false;
+    bool _finished = false;
+
+    void emit(std::string_view bytes);
+    std::string local_header(const record &r) const;
+
+  public:
+    /// @brief Create an archive at @p path.
+    ///
+    /// The archive is written to a temporary file beside @p path,
+    /// which only replaces @p path when the writer is closed.
+    ///
+    /// @param path the name of the archive file
+    /// @throws std::filesystem::filesystem_error if the file cannot be
+    ///   created
+    ///
+    explicit writer(const std::filesystem::path &path);
+
+    writer(const writer &) = delete;
+    writer &operator=(const writer &) = delete;
+
+    /// @brief Abandon the archive if it was not closed.
+    ///
+    /// The temporary file is removed and anything already at the
+    /// archive's path is left as it was.
+    ///
+    ~writer();
+
+    /// @brief Append a member to the archive.
+    ///
+    /// @param e the prepared member
+    ///
+    void add(const entry &e);
+
+    /// @brief Append a member generated as it is written.
+    ///
+    /// @p generate writes the contents to the stream it is given, which
+    /// compresses them into the archive as they arrive, so the member
+    /// is never held in memory.  The checksum and sizes are then filled
+    /// in in the local header.  Unlike @c make_entry, the data is
+    /// deflated even if it does not get smaller.
+    ///
+    /// @param name the path inside the archive
+    /// @param level the compression level (0 stores the data)
+    /// @param generate writes the contents of the member
+    /// @throws std::filesystem::filesystem_error if the archive cannot
+    ///   be written, or the member would need ZIP64 extensions
+    ///
+    void add(const std::string &name, int level,
+             const std::function<void(std::ostream &)> &generate);
+
+    /// @brief Write the central directory and move the finished
+    /// archive into place.
+    ///
+    /// @throws std::filesystem::filesystem_error if the archive cannot
+    ///   be written or renamed
+    ///
+    void close();
+};
+
+/// @brief A reader for archives produced by @c writer.
+///
+/// Only the central directory is read when the archive is opened.
+/// Members are read on demand and returned still encoded, so that
+/// they can be added to a new archive without being recompressed.
+///
+class reader {
+    struct record {
+        enum method method;
+        std::uint32_t crc;
+        std::uint64_t size;
+        std::uint64_t compressed_size;
+        std::uint64_t offset;
+    };
+
+    std::filesystem::path _path;
+    std::ifstream _in;
+    std::map<std::string, record> _directory;
+
+    std::string read(std::uint64_t offset, std::size_t size);
+
+  public:
+    /// @brief Open the archive at @p path.
+    ///
+    /// @param path the name of the archive file
+    /// @throws std::filesystem::filesystem_error if the file cannot be
+    ///   read or is not a ZIP archive
+    ///
+    explicit reader(const std::filesystem::path &path);
+
+    reader(const reader &) = delete;
+    reader &operator=(const reader &) = delete;
+
+    /// @brief Read a member.
+    ///
+    /// @param name the path inside the archive
+    /// @returns the member as it is stored, or an empty optional if
+    ///   the archive has no such member
+    /// @throws std::filesystem::filesystem_error if the member cannot
+    ///   be read
+    ///
+    std::optional<entry> get(const std::string &name);
+};
+
+} // namespace epub::zip
+
+#endif
@@ -1,7 +1,10 @@
 #include "container.hpp"
+#include "copy_file.hpp"
+#include "xml.hpp"
 
 #include <filesystem>
 #include <fstream>
+#include <iterator>
 #include <ranges>
 #include <string>
 #include <system_error>
@@ -69,6 +72,37 @@ int main(int, const char **argv) {
             fail("source duplicates ok");
         }
 
+        c.toc_stylesheet("toc style.css");
+        eq(epub::xml::navigation_document(c),
+           epub::xml::dom::navigation_document(c),
+           "streamed navigation matches DOM");
+        c.toc_stylesheet({});
+
+        for (const auto &path : paths) {
+            epub::file_metadata streamed, dom;
+            epub::xml::get_xhtml_metadata(path, streamed);
+            epub::xml::dom::get_xhtml_metadata(path, dom);
+            ok(streamed == dom, path.filename(), " head metadata matches DOM");
+        }
+
+        {
+            auto partial = fs::temp_directory_path() / "head-only.xhtml";
+            std::ofstream{partial}
+                << "<?xml version=\"1.0\"?>\n"
+                   "<html xmlns=\"http://www.w3.org/1999/xhtml\">\n"
+                   "<head><title>Head &amp; Only</title>\n"
+                   "<meta name=\"epub:subtitle\" content=\"kept\"/></head>\n"
+                   "<body><meta name=\"epub:lost\" content=\"x\"/>\n"
+                   "<p>unterminated";
+
+            epub::file_metadata m;
+            epub::xml::get_xhtml_metadata(partial, m);
+            ok(m == epub::file_metadata{{u8"title", u8"Head & Only"},
+                                        {u8"subtitle", u8"kept"}},
+               "body is not parsed");
+            fs::remove(partial);
+        }
+
         fs::remove_all(output_file);
 
         std::ofstream{output_file};
@@ -103,10 +137,66 @@ int main(int, const char **argv) {
         for (const auto &source : paths) {
             auto path = output_file / "Contents" / source.filename();
             file_exists(path);
+
+            std::ifstream a{source, std::ios::binary};
+            std::ifstream b{path, std::ios::binary};
+            ok(std::string{std::istreambuf_iterator<char>{a}, {}} ==
+                   std::string{std::istreambuf_iterator<char>{b}, {}},
+               path.filename(), " copied intact");
+        }
+
+        try {
+            epub::copy_file(paths.front(),
+                            output_file / "Contents" / "ch1-redux.xhtml");
+            fail("copy_file will not clobber");
+        }
+        catch (const std::system_error &ex) {
+            eq(ex.code(), std::make_error_code(std::errc::file_exists),
+               "copy_file will not clobber");
         }
 
         file_exists(output_file / "Contents" / "ch1-redux.xhtml");
 
+        // procfs reports a size of zero for files that are not empty.
+        if (fs::path status{"/proc/self/status"}; fs::exists(status)) {
+            auto copy = fs::path{output_file}.replace_extension(".status");
+            fs::remove(copy);
+            epub::copy_file(status, copy);
+            ok(fs::file_size(copy) > 0, "file of unknown size copied");
+            fs::remove(copy);
+        }
+        else {
+            skip(1, "no procfs");
+        }
+
+        {
+            auto parallel = fs::path{output_file}.replace_extension(".4");
+            fs::remove_all(parallel);
+
+            c.write(parallel, {.jobs = 4});
+
+            for (const auto &source : paths) {
+                auto path = parallel / "Contents" / source.filename();
+                ok(fs::file_size(path) == fs::file_size(source),
+                   path.filename(), " copied concurrently");
+            }
+        }
+
+        try {
+            auto missing = fs::path{output_file}.replace_extension(".bad");
+            fs::remove_all(missing);
+
+            epub::container bad;
+            bad.add(paths.front());
+            bad.add(fs::path{TESTDIR} / "missing.css");
+            bad.write(missing, {.jobs = 4});
+            fail("concurrent copy errors surface");
+        }
+        catch (const fs::filesystem_error &ex) {
+            eq(ex.path1().filename(), fs::path{"missing.css"},
+               "concurrent copy errors surface");
+        }
+
 #ifdef EPUBCHECK
         auto epubcheck_out = fs::path{output_file}.replace_extension("txt");
         auto epubcheck_cmd = EPUBCHECK " -m exp -v 3.0 -w >"s +
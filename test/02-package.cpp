@@ -4,14 +4,26 @@
 #include "package.hpp"
 #include "xml.hpp"
 
+#include <cstdlib>
 #include <exception>
 #include <filesystem>
 #include <fstream>
 #include <ostream>
 #include <ranges>
+#include <regex>
+#include <string>
 
 #include "tap.hpp"
 
+namespace {
+
+// Generated ids differ between serializations of the same package.
+std::string without_ids(const std::string &document) {
+    return std::regex_replace(document, std::regex{"g[0-9a-f]{8}"}, "g");
+}
+
+} // namespace
+
 namespace std {
 
 void sprint_one(std::ostream &os, const u8string &str) {
@@ -67,6 +79,51 @@ int main(int, const char **argv) {
 
         p.add_to_manifest(std::move(item));
 
+        auto [dup_id, added_id] = p.add_to_manifest({
+            .id = u8"nav",
+            .path = "other.xhtml",
+        });
+        ok(!added_id && dup_id->path == "nav.xhtml", "duplicate id rejected");
+
+        auto [dup_path, added_path] = p.add_to_manifest({
+            .id = u8"other",
+            .path = "nav.xhtml",
+        });
+        ok(!added_path && dup_path->id == u8"nav", "duplicate path rejected");
+
+        eq(std::ranges::distance(p.manifest()), 1, "manifest unchanged");
+
+        {
+            package q;
+
+            q.metadata().title(u8"Tom & Jerry <\u00e9> \"q\"\t\r\n");
+            q.metadata().description(u8"A & B < C ]]> end \u00e9\r\n");
+            q.metadata().creators() = p.metadata().creators();
+            q.metadata().creators().emplace_back(u8"Anonymous"s);
+            q.metadata().collections() = p.metadata().collections();
+            q.metadata().collections().emplace_back(u8"Unsorted");
+            q.metadata().landscape();
+
+            q.add_to_manifest({
+                .path = "a b/\u00e9&.xhtml",
+                .properties = u8"svg \"x\"\t<\u00e9>",
+                .metadata = {{u8"media-type", u8"application/xhtml+xml"}},
+                .in_spine = true,
+            });
+            q.add_to_manifest({
+                .path = "img.png",
+                .metadata = {{u8"media-type", u8"image/png"}},
+            });
+
+            setenv("SOURCE_DATE_EPOCH", "1700000000", 1);
+            auto streamed = xml::package_document(q);
+            auto reference = xml::dom::package_document(q);
+            unsetenv("SOURCE_DATE_EPOCH");
+
+            eq(without_ids(streamed), without_ids(reference),
+               "streamed package matches DOM");
+        }
+
         xml::write_package(output_file, p);
 
         ok(fs::exists(output_file), output_file.filename(), " created");
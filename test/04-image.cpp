@@ -1,12 +1,14 @@
 #include "image_ref.hpp"
 #include "geom.hpp"
 
+#include <algorithm>
 #include <exception>
 #include <filesystem>
 #include <iterator>
 #include <map>
 #include <regex>
 #include <utility>
+#include <vector>
 
 #include "tap.hpp"
 
@@ -67,6 +69,26 @@ int main() {
         eq("480px", properties.at("width"), "width");
         eq("640px", properties.at("height"), "height");
         eq("absolute", properties.at("position"), "position");
+
+        std::vector<std::string> paths(32, imgfile.string());
+        auto infos = probe_images(paths, 4);
+
+        eq(paths.size(), infos.size(), "all images probed");
+        ok(std::ranges::all_of(infos,
+                               [](auto &&i) {
+                                   return i.size == geom::size{480, 640};
+                               }),
+           "concurrent probes agree");
+
+        paths[20] = (testdir / "missing.png").string();
+
+        try {
+            probe_images(paths, 4);
+            fail("probe errors surface");
+        }
+        catch (const std::runtime_error &) {
+            pass("probe errors surface");
+        }
     }
     catch (...) {
         bail_out(std::current_exception());
@@ -0,0 +1,368 @@
+#include "container.hpp"
+#include "zip.hpp"
+
+#include <zlib.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+
+#include "tap.hpp"
+
+namespace {
+
+std::uint32_t get16(const std::string &s, std::size_t pos) {
+    auto b = reinterpret_cast<const unsigned char *>(s.data() + pos);
+    return b[0] | (b[1] << 8);
+}
+
+std::uint32_t get32(const std::string &s, std::size_t pos) {
+    return get16(s, pos) | (get16(s, pos + 2) << 16);
+}
+
+struct member {
+    std::uint16_t method;
+    std::uint32_t crc;
+    std::string data;
+    std::uint32_t size;
+};
+
+// A minimal reader for the archives produced by zip::writer: walks
+// the central directory and extracts each member.
+std::map<std::string, member> read_archive(const std::string &zip) {
+    auto end = zip.rfind("PK\x05\x06");
+    if (end == zip.npos) throw std::runtime_error{"no end record"};
+
+    auto count = get16(zip, end + 10);
+    std::size_t pos = get32(zip, end + 16);
+
+    std::map<std::string, member> result;
+
+    for (unsigned i = 0; i < count; ++i) {
+        if (get32(zip, pos) != 0x02014b50) {
+            throw std::runtime_error{"bad central header"};
+        }
+
+        auto name_len = get16(zip, pos + 28);
+        auto extra_len = get16(zip, pos + 30);
+        auto comment_len = get16(zip, pos + 32);
+        std::size_t offset = get32(zip, pos + 42);
+        std::string name = zip.substr(pos + 46, name_len);
+
+        member m{
+            .method = static_cast<std::uint16_t>(get16(zip, pos + 10)),
+            .crc = get32(zip, pos + 16),
+            .size = get32(zip, pos + 24),
+        };
+
+        auto csize = get32(zip, pos + 20);
+        auto data = offset + 30 + get16(zip, offset + 26) +
+                    get16(zip, offset + 28);
+        m.data = zip.substr(data, csize);
+
+        result.emplace(std::move(name), std::move(m));
+        pos += 46 + name_len + extra_len + comment_len;
+    }
+
+    return result;
+}
+
+std::string inflate_raw(const std::string &data, std::size_t size) {
+    std::string out(size, '\0');
+
+    z_stream zs{};
+    inflateInit2(&zs, -MAX_WBITS);
+    zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.data()));
+    zs.avail_in = static_cast<uInt>(data.size());
+    zs.next_out = reinterpret_cast<Bytef *>(out.data());
+    zs.avail_out = static_cast<uInt>(out.size());
+    auto status = inflate(&zs, Z_FINISH);
+    inflateEnd(&zs);
+
+    if (status != Z_STREAM_END) throw std::runtime_error{"inflate"};
+    return out;
+}
+
+std::uint32_t crc_of(const std::string &data) {
+    return crc32(crc32(0L, Z_NULL, 0),
+                 reinterpret_cast<const Bytef *>(data.data()),
+                 static_cast<uInt>(data.size()));
+}
+
+} // namespace
+
+int main(int, const char **argv) {
+    using namespace tap;
+    using namespace std::literals;
+
+    namespace fs = std::filesystem;
+
+    auto output_file = fs::path(argv[0]).filename();
+    output_file.replace_extension(".epub");
+    output_file = fs::temp_directory_path() / output_file;
+
+    test_plan plan;
+
+    try {
+        auto stored = epub::zip::make_entry("a", "abc", 9);
+        eq(static_cast<int>(stored.method),
+           static_cast<int>(epub::zip::method::stored),
+           "incompressible data is stored");
+
+        auto deflated = epub::zip::make_entry("b", std::string(4096, 'x'), 9);
+        eq(static_cast<int>(deflated.method),
+           static_cast<int>(epub::zip::method::deflated),
+           "compressible data is deflated");
+
+        // Roughly 2% of this compresses away.
+        std::string mostly_random(4096, 'x');
+        std::minstd_rand rng{1};
+        for (auto i = 80U; i < mostly_random.size(); ++i) {
+            mostly_random[i] = static_cast<char>(rng());
+        }
+
+        auto marginal = epub::zip::make_entry("c", mostly_random, 9);
+        eq(static_cast<int>(marginal.method),
+           static_cast<int>(epub::zip::method::deflated),
+           "any savings are deflated by default");
+
+        marginal = epub::zip::make_entry("c", mostly_random, 9, 5);
+        eq(static_cast<int>(marginal.method),
+           static_cast<int>(epub::zip::method::stored),
+           "marginal savings are stored");
+
+        epub::compression_policy policy;
+        eq(policy.level_for("Contents/page.jpg"), 0, "jpeg stored");
+        eq(policy.level_for("Contents/page.png"), 0, "png stored");
+        eq(policy.level_for("Contents/page.xhtml"), 4, "xhtml deflated");
+        eq(policy.level_for("Contents/package.opf"), 4, "opf deflated");
+
+        std::vector<fs::path> paths;
+
+        for (auto &&entry : fs::directory_iterator(TESTDIR)) {
+            if (entry.path().extension() != ".xhtml") continue;
+            paths.emplace_back(entry.path());
+        }
+
+        std::ranges::sort(paths);
+
+        epub::container c;
+        c.package().metadata().title(u8"The Plastic Age");
+
+        for (const auto &path : paths) c.add(path);
+
+        fs::remove_all(output_file);
+
+        c.write(output_file, {.format = epub::output_format::packaged});
+
+        ok(fs::is_regular_file(output_file), output_file, " is a file");
+
+        std::ifstream in{output_file, std::ios::binary};
+        std::string zip{std::istreambuf_iterator<char>{in}, {}};
+
+        eq(zip.substr(0, 4), "PK\x03\x04"s, "local header first");
+        eq(zip.substr(30, 8), "mimetype"s, "mimetype first");
+        eq(get16(zip, 8), 0U, "mimetype stored");
+        eq(zip.substr(38, 20), "application/epub+zip"s, "mimetype data");
+
+        auto members = read_archive(zip);
+
+        std::set<std::string> expected = {
+            "mimetype",
+            "META-INF/container.xml",
+            "Contents/package.opf",
+            "Contents/nav.xhtml",
+        };
+
+        for (auto &&path : paths) {
+            expected.insert("Contents/" + path.filename().string());
+        }
+
+        std::set<std::string> actual;
+        for (auto &&[name, m] : members) actual.insert(name);
+
+        ok(expected == actual, "member names");
+
+        for (auto &&[name, m] : members) {
+            auto data = m.method == 8 ? inflate_raw(m.data, m.size) : m.data;
+            eq(crc_of(data), m.crc, name, " checksum");
+        }
+
+        for (auto &&path : paths) {
+            std::ifstream src{path, std::ios::binary};
+            std::string original{std::istreambuf_iterator<char>{src}, {}};
+
+            auto &m = members.at("Contents/" + path.filename().string());
+            auto data = m.method == 8 ? inflate_raw(m.data, m.size) : m.data;
+
+            ok(data == original, path.filename(), " round trip");
+        }
+
+        {
+            auto serial = fs::path{output_file}.replace_extension(".1.epub");
+            auto parallel = fs::path{output_file}.replace_extension(".4.epub");
+
+            fs::remove_all(serial);
+            fs::remove_all(parallel);
+
+            setenv("SOURCE_DATE_EPOCH", "1700000000", 1);
+
+            c.write(serial, {.format = epub::output_format::packaged,
+                             .jobs = 1});
+            c.write(parallel, {.format = epub::output_format::packaged,
+                               .jobs = 4});
+
+            unsetenv("SOURCE_DATE_EPOCH");
+
+            std::ifstream a{serial, std::ios::binary};
+            std::ifstream b{parallel, std::ios::binary};
+
+            ok(std::string{std::istreambuf_iterator<char>{a}, {}} ==
+                   std::string{std::istreambuf_iterator<char>{b}, {}},
+               "archive independent of job count");
+        }
+
+        try {
+            c.write(output_file, {.format = epub::output_format::packaged});
+            fail("will not clobber");
+        }
+        catch (const std::system_error &ex) {
+            eq(ex.code(), std::make_error_code(std::errc::file_exists),
+               "will not clobber");
+        }
+
+        {
+            auto streamed = fs::path{output_file}.replace_extension(".s.zip");
+
+            // Larger than the buffers the members are written through.
+            std::string text;
+            for (int i = 0; text.size() < 300000; ++i) {
+                text += "line " + std::to_string(i) + "\n";
+            }
+
+            {
+                epub::zip::writer w{streamed};
+                for (int level : {0, 6}) {
+                    w.add("level" + std::to_string(level), level,
+                          [&](std::ostream &out) { out << text; });
+                }
+                w.close();
+            }
+
+            std::ifstream in{streamed, std::ios::binary};
+            auto members = read_archive(
+                std::string{std::istreambuf_iterator<char>{in}, {}});
+
+            for (auto &&[name, m] : members) {
+                auto data =
+                    m.method == 8 ? inflate_raw(m.data, m.size) : m.data;
+                ok(data == text && crc_of(data) == m.crc, name,
+                   " streamed");
+            }
+
+            fs::remove(streamed);
+        }
+
+        {
+            auto failed = fs::path{output_file}.replace_extension(".f.epub");
+            auto temporary = fs::path{failed} += ".tmp";
+            const epub::output_options archive = {
+                .format = epub::output_format::packaged,
+                .incremental = true,
+            };
+
+            fs::remove(failed);
+
+            {
+                auto out = epub::open_output(failed, archive);
+                out->write("Contents/a.xhtml", "a");
+            }
+            ok(!fs::exists(failed) && !fs::exists(temporary),
+               "unfinished archive removed");
+
+            {
+                auto out = epub::open_output(failed, archive);
+                out->write("Contents/a.xhtml", "a");
+                out->close();
+            }
+            auto size = fs::file_size(failed);
+
+            {
+                auto out = epub::open_output(failed, archive);
+                out->write("Contents/b.xhtml", "b");
+            }
+            ok(fs::file_size(failed) == size && !fs::exists(temporary),
+               "unfinished update leaves the previous build");
+
+            fs::remove(failed);
+        }
+
+        {
+            auto corrupt = fs::path{output_file}.replace_extension(".c.zip");
+
+            {
+                epub::zip::writer w{corrupt};
+                w.add(epub::zip::make_entry("a", "abc", 0));
+                w.close();
+            }
+
+            std::ifstream in{corrupt, std::ios::binary};
+            const std::string good{std::istreambuf_iterator<char>{in}, {}};
+            in.close();
+
+            const auto central = good.find("PK\x01\x02");
+            const auto end = good.rfind("PK\x05\x06");
+
+            auto rejected = [&](std::size_t pos, std::string_view bytes) {
+                auto bad = good;
+                bad.replace(pos, bytes.size(), bytes);
+                std::ofstream{corrupt, std::ios::binary} << bad;
+
+                try {
+                    epub::zip::reader r{corrupt};
+                    return false;
+                }
+                catch (const fs::filesystem_error &e) {
+                    return e.code() == std::errc::invalid_argument;
+                }
+            };
+
+            ok(rejected(central + 28, "\xff\xff"),
+               "name past the directory rejected");
+            ok(rejected(central + 30, "\x20\x00"sv),
+               "extra field past the directory rejected");
+            ok(rejected(central + 20, "\xff\xff\xff\xff"),
+               "member past the file rejected");
+            ok(rejected(end + 16, "\x00\x00\x01\x00"sv),
+               "directory past the file rejected");
+
+            fs::remove(corrupt);
+        }
+
+#ifdef EPUBCHECK
+        auto epubcheck_out = fs::path{output_file}.replace_extension("txt");
+        auto epubcheck_cmd = EPUBCHECK " -w >"s + epubcheck_out.string() +
+                             " 2>&1 "s + output_file.string();
+
+        diag("Running: ", epubcheck_cmd);
+
+        if (!eq(std::system(epubcheck_cmd.c_str()), 0)) {
+            std::ifstream log{epubcheck_out};
+            for (std::string s; std::getline(log, s);) {
+                diag("epubcheck: ", s);
+            }
+        }
+#else
+        skip(1, "epubcheck disabled");
+#endif
+    }
+    catch (...) {
+        bail_out(std::current_exception());
+    }
+}
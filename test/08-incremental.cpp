@@ -0,0 +1,142 @@
+#include "build_cache.hpp"
+#include "container.hpp"
+#include "zip.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include "tap.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+std::string slurp(const fs::path &path) {
+    std::ifstream in{path, std::ios::binary};
+    return {std::istreambuf_iterator<char>{in}, {}};
+}
+
+epub::container make_container(const fs::path &sources,
+                               const fs::path &output) {
+    epub::container c;
+    c.package().metadata().title(u8"The Plastic Age");
+    c.cache(std::make_shared<epub::build_cache>(
+        epub::build_cache::sidecar(output)));
+
+    for (auto &&name : {"pach1.xhtml", "pach2.xhtml", "pach3.xhtml"}) {
+        if (exists(sources / name)) c.add(sources / name);
+    }
+
+    return c;
+}
+
+} // namespace
+
+int main(int, const char **argv) {
+    using namespace tap;
+    using namespace std::literals;
+
+    auto root = fs::temp_directory_path() / fs::path(argv[0]).filename();
+    auto sources = root / "src";
+    auto expanded = root / "book";
+    auto packaged = root / "book.epub";
+
+    test_plan plan;
+
+    try {
+        fs::remove_all(root);
+        create_directories(sources);
+
+        for (auto &&name : {"pach1.xhtml", "pach2.xhtml", "pach3.xhtml"}) {
+            fs::copy_file(fs::path{TESTDIR} / name, sources / name);
+        }
+
+        const epub::output_options incremental = {.incremental = true};
+        const epub::output_options archive = {
+            .format = epub::output_format::packaged,
+            .incremental = true,
+        };
+
+        make_container(sources, expanded).write(expanded, incremental);
+        make_container(sources, packaged).write(packaged, archive);
+
+        ok(fs::exists(epub::build_cache::sidecar(expanded)), "cache saved");
+
+        auto chapter = expanded / "Contents" / "pach1.xhtml";
+        auto before = fs::last_write_time(chapter);
+        auto nav = expanded / "Contents" / "nav.xhtml";
+        auto nav_before = fs::last_write_time(nav);
+
+        // Nothing changed: files are kept as they are.
+
+        make_container(sources, expanded).write(expanded, incremental);
+        ok(fs::last_write_time(chapter) == before, "unchanged file kept");
+        ok(fs::last_write_time(nav) == nav_before,
+           "unchanged navigation document kept");
+
+        // One chapter changed.
+
+        auto edited = slurp(sources / "pach2.xhtml");
+        edited.insert(edited.rfind("</body>"), "<p>Postscript.</p>\n");
+        std::ofstream{sources / "pach2.xhtml"} << edited;
+
+        make_container(sources, expanded).write(expanded, incremental);
+        ok(fs::last_write_time(chapter) == before, "other files kept");
+        ok(slurp(expanded / "Contents" / "pach2.xhtml") == edited,
+           "changed file rewritten");
+
+        make_container(sources, packaged).write(packaged, archive);
+
+        {
+            epub::zip::reader reader{packaged};
+            auto member = reader.get("Contents/pach2.xhtml");
+            ok(member.has_value(), "changed member present");
+            eq(member ? member->size : 0, edited.size(),
+               "changed member updated");
+            ok(reader.get("Contents/pach1.xhtml").has_value(),
+               "unchanged member kept");
+            ok(!reader.get("Contents/missing.xhtml"), "no missing member");
+        }
+
+        ok(!fs::exists(fs::path{packaged} += ".tmp"), "temporary removed");
+
+        // A chapter was dropped.
+
+        fs::remove(sources / "pach3.xhtml");
+
+        make_container(sources, expanded).write(expanded, incremental);
+        ok(!fs::exists(expanded / "Contents" / "pach3.xhtml"),
+           "stale file removed");
+        ok(slurp(expanded / "Contents" / "package.opf").find("pach3") ==
+               std::string::npos,
+           "package updated");
+
+        make_container(sources, packaged).write(packaged, archive);
+
+        {
+            epub::zip::reader reader{packaged};
+            ok(!reader.get("Contents/pach3.xhtml"), "stale member removed");
+        }
+
+        // A source named by a path that is not normal is cached under
+        // its normal form.
+
+        auto dotted = root / "dotted";
+        {
+            epub::container c;
+            c.cache(std::make_shared<epub::build_cache>(
+                epub::build_cache::sidecar(dotted)));
+            c.add(sources / "." / "pach1.xhtml");
+            c.write(dotted, incremental);
+        }
+
+        epub::build_cache cache{epub::build_cache::sidecar(dotted)};
+        ok(cache.metadata(sources / "pach1.xhtml").has_value(),
+           "metadata cached under the normal path");
+    }
+    catch (...) {
+        bail_out(std::current_exception());
+    }
+}
@@ -0,0 +1,131 @@
+#include "container.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "tap.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr std::size_t document_count = 10000;
+
+void write_document(const fs::path &path, std::size_t n) {
+    std::ofstream out{path};
+
+    out << "<?xml version=\"1.0\"?>\n"
+           "<html xmlns=\"http://www.w3.org/1999/xhtml\">\n"
+           "<head><title>Document "
+        << n << "</title>\n";
+
+    if (n % 3 == 0) {
+        out << "<meta name=\"epub:properties\" content=\"scripted\"/>\n";
+    }
+    if (n % 7 == 0) {
+        out << "<meta name=\"epub:spine\" content=\"omit\"/>\n";
+    }
+
+    out << "</head>\n<body><p>" << n << "</p></body>\n</html>\n";
+}
+
+bool same_item(const epub::manifest_item &a, const epub::manifest_item &b) {
+    return a.path == b.path && a.properties == b.properties &&
+           a.metadata == b.metadata && a.in_spine == b.in_spine &&
+           a.in_toc == b.in_toc;
+}
+
+} // namespace
+
+int main(int, const char **argv) {
+    using namespace tap;
+    using namespace std::literals;
+
+    auto root = fs::temp_directory_path() / fs::path(argv[0]).filename();
+
+    test_plan plan;
+
+    try {
+        fs::remove_all(root);
+        create_directories(root);
+
+        std::vector<epub::container::source_file> files;
+
+        for (std::size_t n = 0; n < document_count; ++n) {
+            auto name = "doc" + std::to_string(n) + ".xhtml";
+            write_document(root / name, n);
+            files.push_back({.source = root / name, .local = name});
+        }
+
+        epub::container serial, parallel;
+
+        for (auto &&f : files) serial.add(f.source, f.local);
+        parallel.add(files, 16);
+
+        auto expected = serial.package().manifest();
+        auto actual = parallel.package().manifest();
+
+        eq(std::ranges::distance(actual), std::ranges::distance(expected),
+           "all documents added");
+
+        auto e = expected.begin();
+        auto a = actual.begin();
+        std::size_t mismatches = 0;
+
+        for (; e != expected.end() && a != actual.end(); ++e, ++a) {
+            if (!same_item(*a, *e)) ++mismatches;
+        }
+
+        eq(mismatches, 0U, "parallel manifest matches serial in order");
+
+        epub::file_metadata last = {
+            {u8"title", u8"Document 9999"},
+            {u8"properties", u8"scripted"},
+            {u8"media-type", u8"application/xhtml+xml"},
+        };
+        ok(std::prev(actual.end())->metadata == last,
+           "metadata parsed from the last document");
+
+        epub::container c;
+        c.add({files.begin(), files.begin() + 10}, 4);
+        auto before = std::ranges::distance(c.package().manifest());
+
+        try {
+            c.add({files.begin() + 5, files.begin() + 15}, 4);
+            fail("duplicates rejected");
+        }
+        catch (const epub::duplicate_error &) {
+            pass("duplicates rejected");
+        }
+
+        // A batch repeating one of its own names must fail as a whole.
+        std::vector batch(files.begin() + 20, files.begin() + 30);
+        batch.push_back(files[25]);
+
+        try {
+            c.add(batch, 4);
+            fail("duplicates within a batch rejected");
+        }
+        catch (const epub::duplicate_error &) {
+            pass("duplicates within a batch rejected");
+        }
+
+        eq(std::ranges::distance(c.package().manifest()), before,
+           "failed batches leave the manifest unchanged");
+
+        try {
+            c.add({files.begin() + 10, files.begin() + 30}, 4);
+            pass("names from failed batches still free");
+        }
+        catch (const epub::duplicate_error &) {
+            fail("names from failed batches still free");
+        }
+    }
+    catch (...) {
+        bail_out(std::current_exception());
+    }
+
+    fs::remove_all(root);
+}
@@ -0,0 +1,83 @@
+#include "page_template.hpp"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "tap.hpp"
+
+int main() {
+    using namespace tap;
+    using namespace std::literals;
+
+    using epub::xml::page_image;
+    using epub::xml::page_template;
+
+    namespace dom = epub::xml::dom;
+
+    test_plan plan;
+
+    try {
+        const auto viewport = u8"width=1536, height=2048"sv;
+        const auto style =
+            u8"position: absolute; top: 0px; left: 0px; width: 1536px; "
+            u8"height: 1024px"sv;
+
+        const std::vector<page_image> images = {
+            {.style = style, .src = u8"im0001.jpeg"},
+            {.style = u8"top: \"1\" & <2>\t\n\r", .src = u8"a b/é.png"},
+        };
+
+        page_template plain{u8"Comic Page"};
+        std::string buffer;
+
+        plain.render(buffer, viewport, {});
+        eq(buffer, dom::page_document(u8"Comic Page", {}, {}, viewport, {}),
+           "empty page matches DOM");
+
+        plain.render(buffer, viewport, images);
+        eq(buffer,
+           dom::page_document(u8"Comic Page", {}, {}, viewport, images),
+           "page matches DOM");
+
+        const auto title = u8"Comic & <Page> é"sv;
+        const auto css = u8"img { border: 0 } /* ]]> */"sv;
+
+        page_template styled{title, css};
+
+        styled.render(buffer, viewport, images);
+        eq(buffer, dom::page_document(title, css, {}, viewport, images),
+           "escaped title and stylesheet match DOM");
+
+        const std::vector<page_image> classed = {
+            {.class_name = u8"f0", .src = u8"im0001.jpeg"},
+            {.class_name = u8"f1", .src = u8"im0002.jpeg"},
+        };
+
+        page_template linked{u8"Comic Page", {}, u8"frames.css"};
+
+        linked.render(buffer, viewport, classed);
+        eq(buffer,
+           dom::page_document(u8"Comic Page", {}, u8"frames.css", viewport,
+                              classed),
+           "linked stylesheet and classes match DOM");
+        ok(buffer.find("style=") == buffer.npos, "no inline styles");
+
+        std::vector<page_image> strip(3, images.front());
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < 10000; ++i) {
+            plain.render(buffer, viewport, strip);
+        }
+        std::chrono::duration<double, std::milli> elapsed =
+            std::chrono::steady_clock::now() - start;
+
+        diag("10000 pages in ", elapsed.count(), " ms");
+        eq(buffer,
+           dom::page_document(u8"Comic Page", {}, {}, viewport, strip),
+           "buffer reuse");
+    }
+    catch (...) {
+        bail_out(std::current_exception());
+    }
+}
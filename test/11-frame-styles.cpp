@@ -0,0 +1,29 @@
+#include "frame_styles.hpp"
+
+#include <string>
+
+#include "tap.hpp"
+
+int main() {
+    using namespace tap;
+
+    test_plan plan;
+
+    epub::comic::frame_styles frames;
+
+    geom::rect top{0, 0, 1536, 1024}, bottom{0, 1024, 1536, 1024};
+
+    ok(frames.class_name(top) == u8"f0", "first frame");
+    ok(frames.class_name(bottom) == u8"f1", "second frame");
+    ok(frames.class_name(geom::rect{0, 0, 1536, 1024}) == u8"f0",
+       "equal frames share a class");
+    eq(frames.size(), 2U, "distinct frames counted");
+
+    eq(frames.stylesheet(),
+       std::string{"img { position: absolute }\n"
+                   "img.f0 { top: 0px; left: 0px; width: 1536px; "
+                   "height: 1024px }\n"
+                   "img.f1 { top: 1024px; left: 0px; width: 1536px; "
+                   "height: 1024px }\n"},
+       "stylesheet");
+}
@@ -0,0 +1,72 @@
+#include "image_cache.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "tap.hpp"
+
+namespace fs = std::filesystem;
+
+int main(int, const char **argv) {
+    using namespace tap;
+
+    using epub::comic::image_cache;
+    using epub::comic::image_info;
+
+    auto root = fs::temp_directory_path() / fs::path(argv[0]).filename();
+    auto cache_file = root / "images.cache";
+    auto image = root / "strip.png";
+
+    test_plan plan;
+
+    try {
+        fs::remove_all(root);
+        create_directories(root);
+
+        std::ofstream{image} << "not really a PNG";
+
+        const image_info info{u8"image/png", ".png", geom::size{480, 640}};
+
+        {
+            image_cache cache{cache_file};
+            ok(!cache.find(image), "empty cache misses");
+
+            cache.insert(image, info);
+            cache.save();
+        }
+
+        {
+            image_cache cache{cache_file};
+            auto found = cache.find(image);
+
+            if (ok(found.has_value(), "reloaded cache hits")) {
+                ok(found->media_type == info.media_type, "media type");
+                eq(found->extension, info.extension, "extension");
+                eq(found->size, info.size, "size");
+            }
+            else {
+                skip(3, "no entry");
+            }
+
+            ok(cache.find(fs::relative(image)).has_value(),
+               "relative paths share entries");
+
+            std::ofstream{image, std::ios::app} << " any more";
+            ok(!cache.find(image), "changed file misses");
+        }
+
+        {
+            std::ofstream out{cache_file, std::ios::binary};
+            out << "epubutil-images 1\n" << std::string(5, '\xff');
+        }
+
+        image_cache damaged{cache_file};
+        ok(!damaged.find(image), "damaged cache is empty");
+    }
+    catch (...) {
+        bail_out(std::current_exception());
+    }
+
+    fs::remove_all(root);
+}
@@ -0,0 +1,69 @@
+#include "mapped_reader.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "tap.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+std::string pattern(std::size_t size) {
+    std::string s(size, '\0');
+    for (std::size_t i = 0; i < size; ++i) {
+        s[i] = static_cast<char>(i * 7 % 251);
+    }
+    return s;
+}
+
+std::string read(epub::comic::mapped_reader &reader, off_t offset,
+                 std::size_t size) {
+    std::string buf(size, 'x');
+    reader.read(buf.data(), offset, size);
+    return buf;
+}
+
+} // namespace
+
+int main(int, const char **argv) {
+    using namespace tap;
+
+    using epub::comic::mapped_reader;
+
+    auto root = fs::temp_directory_path() / fs::path(argv[0]).filename();
+
+    test_plan plan;
+
+    try {
+        fs::remove_all(root);
+        create_directories(root);
+
+        const std::size_t small = 100, large = 4 * mapped_reader::small_file;
+
+        for (std::size_t size : {small, large}) {
+            auto data = pattern(size);
+            auto path = root / ("file" + std::to_string(size));
+            std::ofstream{path, std::ios::binary} << data;
+
+            mapped_reader reader{path};
+            auto what = std::to_string(size) + " bytes: ";
+
+            eq(reader.size(), size, what, "size");
+            eq(read(reader, 0, 16), data.substr(0, 16), what, "start");
+            eq(read(reader, 50, 30), data.substr(50, 30), what, "middle");
+            eq(read(reader, static_cast<off_t>(size - 10), 20),
+               data.substr(size - 10) + std::string(10, '\0'), what,
+               "past the end");
+        }
+
+        mapped_reader missing{root / "missing.jpeg"};
+        eq(missing.size(), 0U, "missing file is empty");
+    }
+    catch (...) {
+        bail_out(std::current_exception());
+    }
+
+    fs::remove_all(root);
+}
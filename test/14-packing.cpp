@@ -0,0 +1,81 @@
+#include "packing.hpp"
+
+#include <algorithm>
+#include <vector>
+
+#include "tap.hpp"
+
+namespace {
+
+using breaks = std::vector<std::size_t>;
+
+/// The number of pages used by filling each page in turn.
+std::size_t first_fit_pages(const std::vector<std::size_t> &heights,
+                            std::size_t capacity) {
+    std::size_t pages = 0, used = capacity;
+
+    for (auto h : heights) {
+        if (used + h > capacity) {
+            ++pages;
+            used = 0;
+        }
+        used += h;
+    }
+
+    return pages;
+}
+
+bool pages_fit(const std::vector<std::size_t> &heights, breaks b,
+               std::size_t capacity) {
+    b.push_back(heights.size());
+
+    for (std::size_t p = 0; p + 1 < b.size(); ++p) {
+        std::size_t used = 0;
+        for (auto i = b[p]; i < b[p + 1]; ++i) used += heights[i];
+        if (b[p] >= b[p + 1] || used > capacity) return false;
+    }
+
+    return b.front() == 0;
+}
+
+} // namespace
+
+int main() {
+    using namespace tap;
+    using epub::comic::balanced_breaks;
+
+    test_plan plan;
+
+    ok(balanced_breaks({}, 100).empty(), "no images, no pages");
+
+    std::vector<std::size_t> one{40};
+    ok(balanced_breaks(one, 100) == breaks{0}, "single image");
+
+    // First fit gives pages of 90, 90 and 20.
+    std::vector<std::size_t> strips{30, 30, 30, 30, 30, 30, 20};
+    ok(balanced_breaks(strips, 100) == breaks{0, 2, 4},
+       "white space spread evenly");
+
+    std::vector<std::size_t> full{50, 50, 50, 50};
+    ok(balanced_breaks(full, 100) == breaks{0, 2}, "full pages kept");
+
+    try {
+        std::vector<std::size_t> tall{50, 150};
+        balanced_breaks(tall, 100);
+        fail("oversized image rejected");
+    }
+    catch (const std::invalid_argument &) {
+        pass("oversized image rejected");
+    }
+
+    std::vector<std::size_t> many;
+    for (std::size_t i = 0; i < 20000; ++i) {
+        many.push_back(300 + (i * 7919) % 900);
+    }
+
+    auto b = balanced_breaks(many, 2048);
+
+    ok(pages_fit(many, b, 2048), "every page fits");
+    eq(b.size(), first_fit_pages(many, 2048),
+       "no more pages than first fit");
+}
@@ -0,0 +1,176 @@
+#include "book.hpp"
+#include "image_table.hpp"
+#include "worker_pool.hpp"
+
+#include <future>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "tap.hpp"
+
+int main() {
+    using namespace tap;
+    using namespace std::literals;
+    using namespace epub::comic;
+
+    using range = std::pair<std::size_t, std::size_t>;
+
+    test_plan plan;
+
+    const image_info strip{u8"image/png", ".png", {600, 500}};
+    const image_info photo{u8"image/jpeg", ".jpg", {300, 400}};
+
+    image_table table;
+
+    table.add("a/one.png", strip);
+    table.add("a/two.jpg", photo);
+    table.add("b/three.png", strip);
+
+    eq(table.size(), 3U, "images added");
+    eq(table.path(1), "a/two.jpg"sv, "path");
+    ok(table.media_type(1) == u8"image/jpeg", "media type");
+    eq(table.local(2), std::filesystem::path{"im00003.png"}, "local");
+    eq(geom::rect{0, 0, 300, 400}, table.frame(1), "frame");
+
+    table.fit(0, 2, {1200, 1200});
+    eq(geom::rect{0, 0, 1200, 1000}, table.frame(0), "enlarged to fit");
+    eq(geom::rect{0, 0, 900, 1200}, table.frame(1), "enlarged to height");
+    eq(geom::rect{0, 0, 600, 500}, table.frame(2), "outside range");
+
+    table.fit(0, 3, {900, 900}, true);
+    eq(geom::rect{0, 0, 1200, 1000}, table.frame(0), "grow only");
+    eq(geom::size{600, 500}, table.source_size(0), "source size kept");
+
+    table.erase_front(2);
+    eq(table.path(0), "b/three.png"sv, "path after erase");
+    eq(table.local(0), std::filesystem::path{"im00003.png"},
+       "number kept after erase");
+
+    // Strips on a landscape page.
+
+    auto fill = [&](book &b, packing_mode mode, std::size_t n) {
+        for (std::size_t i = 0; i < n; ++i) {
+            b.images().add("s/" + std::to_string(i) + ".png", strip);
+            b.place_image(mode);
+        }
+    };
+
+    book stacked{{2048, 1536}}, shelved{{2048, 1536}};
+
+    stacked.add_chapter(u8"s");
+    fill(stacked, packing_mode::stacked, 9);
+    shelved.add_chapter(u8"s");
+    fill(shelved, packing_mode::shelved, 9);
+
+    eq(stacked.page_count(), 3U, "stacked pages");
+    eq(shelved.page_count(), 1U, "shelved pages");
+    ok(shelved.page_images(0) == range{0, 9}, "shelved images");
+
+    shelved.layout(0, separation_mode::external);
+
+    eq(geom::rect{124, 18, 600, 500}, shelved.images().frame(0),
+       "first shelved frame");
+    eq(geom::rect{724, 518, 600, 500}, shelved.images().frame(4),
+       "middle shelved frame");
+
+    stacked.layout(1, separation_mode::external);
+
+    eq(geom::rect{724, 18, 600, 500}, stacked.images().frame(3),
+       "stacked frames centered");
+    eq(stacked.page_path(1), std::filesystem::path{"pg0002.xhtml"},
+       "page path");
+
+    book mixed{{2048, 1536}};
+    mixed.add_chapter(u8"m");
+    mixed.images().add("m/1.png", strip);
+    mixed.images().add("m/2.png", image_info{u8"image/png", ".png",
+                                             {600, 300}});
+    mixed.place_image(packing_mode::shelved);
+    mixed.place_image(packing_mode::shelved);
+    mixed.layout(0, separation_mode::internal);
+
+    eq(geom::rect{0, 0, 600, 500}, mixed.images().frame(0), "row spread");
+    eq(geom::rect{1448, 100, 600, 300}, mixed.images().frame(1),
+       "short image centered in row");
+
+    // Pages share no frames, so they may be laid out concurrently.
+
+    book serial{{2048, 1536}}, parallel{{2048, 1536}};
+
+    serial.add_chapter(u8"p");
+    fill(serial, packing_mode::shelved, 40);
+    parallel.add_chapter(u8"p");
+    fill(parallel, packing_mode::shelved, 40);
+
+    for (std::size_t p = 0; p < serial.page_count(); ++p) {
+        serial.layout(p, separation_mode::distributed);
+    }
+
+    {
+        epub::worker_pool pool{4};
+        std::vector<std::future<void>> done;
+        for (std::size_t p = 0; p < parallel.page_count(); ++p) {
+            done.push_back(pool.submit([&parallel, p] {
+                parallel.layout(p, separation_mode::distributed);
+            }));
+        }
+        for (auto &&f : done) f.get();
+    }
+
+    ok(serial.images().x == parallel.images().x &&
+           serial.images().y == parallel.images().y,
+       "concurrent layout");
+
+    // First fit leaves 0, 200 and 600 pixels of white space.
+
+    book balanced{{600, 1000}};
+    balanced.add_chapter(u8"b");
+    for (auto &&info : {strip, strip, photo, photo, photo}) {
+        balanced.images().add("b.png", info);
+        balanced.place_image();
+    }
+
+    balanced.balance();
+
+    eq(balanced.page_count(), 3U, "balancing keeps pages");
+    ok(balanced.page_images(0) == range{0, 1} &&
+           balanced.page_images(1) == range{1, 3} &&
+           balanced.page_images(2) == range{3, 5},
+       "balanced breaks");
+
+    // Pages are flushed in order and removed with their images.
+
+    book streamed{{600, 1000}};
+    std::vector<std::pair<std::filesystem::path, std::u8string>> written;
+
+    auto record = [&](const book::chapter &ch, std::size_t p, bool first) {
+        auto [begin, end] = streamed.page_images(p);
+        written.emplace_back(streamed.page_path(p),
+                             first ? ch.name : std::u8string{});
+        for (auto i = begin; i < end; ++i) {
+            written.emplace_back(streamed.images().local(i), u8"");
+        }
+    };
+
+    streamed.add_chapter(u8"one");
+    fill(streamed, packing_mode::stacked, 3);
+    streamed.flush(1, record);
+
+    eq(streamed.page_count(), 1U, "last page kept");
+    eq(streamed.images().size(), 1U, "written images removed");
+
+    streamed.add_chapter(u8"two");
+    fill(streamed, packing_mode::stacked, 1);
+    streamed.flush(0, record);
+
+    ok(streamed.empty(), "written chapters removed");
+    ok(written == decltype(written){{"pg0001.xhtml", u8"one"},
+                                    {"im00001.png", u8""},
+                                    {"im00002.png", u8""},
+                                    {"pg0002.xhtml", u8""},
+                                    {"im00003.png", u8""},
+                                    {"pg0003.xhtml", u8"two"},
+                                    {"im00004.png", u8""}},
+       "pages written once, in order");
+}
@@ -0,0 +1,68 @@
+#include "geom_batch.hpp"
+
+#include <cstdint>
+#include <vector>
+
+#include "tap.hpp"
+
+namespace {
+
+/// Sizes from a fixed linear congruential sequence.
+void synthesize(std::vector<coord> &w, std::vector<coord> &h,
+                std::size_t n) {
+    std::uint64_t state = 1;
+
+    auto next = [&] {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        return static_cast<coord>(state >> 33);
+    };
+
+    for (std::size_t i = 0; i < n; ++i) {
+        w.push_back(1 + next() % 5000);
+        h.push_back(1 + next() % 5000);
+    }
+}
+
+bool same_as_scalar(std::vector<coord> w, std::vector<coord> h,
+                    const geom::size &bounds, bool grow_only) {
+    auto ws = w, hs = h;
+
+    fit_sizes(w, h, bounds, grow_only);
+    fit_sizes_scalar(ws, hs, bounds, grow_only);
+
+    return w == ws && h == hs;
+}
+
+} // namespace
+
+int main() {
+    using namespace tap;
+
+    test_plan plan;
+
+    diag("using ", fit_sizes_isa());
+
+    std::vector<coord> w, h;
+    synthesize(w, h, 100003);
+
+    ok(same_as_scalar(w, h, {1536, 2048}, false), "fit matches scalar");
+    ok(same_as_scalar(w, h, {1536, 2048}, true), "grow matches scalar");
+    ok(same_as_scalar(w, h, {7, 3}, false), "small bounds match scalar");
+
+    // 2.5 rounds away from zero, to 3.
+    std::vector<coord> tw{2, 2, 2, 2, 2}, th{1, 1, 1, 1, 1};
+    fit_sizes(tw, th, {5, 100});
+    ok(tw == std::vector<coord>(5, 5) && th == std::vector<coord>(5, 3),
+       "halfway rounds away from zero");
+
+    std::vector<coord> big_w(4, 3000000000U), big_h(4, 3000000000U);
+    fit_sizes(big_w, big_h, {4294967295U, 4294967295U});
+    ok(big_w == std::vector<coord>(4, 4294967295U),
+       "full range of coordinates");
+
+    std::vector<coord> same_w(6, 1536), same_h(6, 2048);
+    fit_sizes(same_w, same_h, {1536, 2048});
+    ok(same_w == std::vector<coord>(6, 1536) &&
+           same_h == std::vector<coord>(6, 2048),
+       "fitting sizes unchanged");
+}
@@ -0,0 +1,112 @@
+#include "resample.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef HAVE_LIBPNG
+#include <png.h>
+#endif
+
+#include "tap.hpp"
+
+#ifdef HAVE_LIBPNG
+
+namespace {
+
+/// The size recorded in the header of a PNG file.
+geom::size png_size(const std::string &data) {
+    auto word = [&](std::size_t at) {
+        geom::coord n = 0;
+        for (std::size_t i = at; i < at + 4; ++i) {
+            n = n << 8 | static_cast<std::uint8_t>(data[i]);
+        }
+        return n;
+    };
+
+    return {word(16), word(20)};
+}
+
+} // namespace
+
+#endif
+
+int main() {
+    using namespace tap;
+    using namespace epub::comic;
+
+    test_plan plan;
+
+    bitmap grey{{90, 60}, 3, std::vector<std::uint8_t>(90 * 60 * 3, 128)};
+
+    auto small = resize(grey, {31, 17});
+
+    eq(geom::size{31, 17}, small.size, "resized");
+    eq(small.pixels.size(), 31U * 17U * 3U, "every sample written");
+    ok(std::ranges::all_of(small.pixels, [](auto v) { return v == 128; }),
+       "flat image stays flat");
+
+    // Transparent pixels are red, opaque ones blue; red must not show
+    // where the two are mixed.
+
+    bitmap mixed{{40, 40}, 4, {}};
+    for (std::size_t i = 0; i < 40 * 40; ++i) {
+        bool opaque = (i % 40) >= 20;
+        mixed.pixels.insert(mixed.pixels.end(),
+                            {std::uint8_t(opaque ? 0 : 255), 0,
+                             std::uint8_t(opaque ? 255 : 0),
+                             std::uint8_t(opaque ? 255 : 0)});
+    }
+
+    auto blended = resize(mixed, {10, 10});
+    bool bled = false;
+    for (std::size_t i = 0; i < blended.pixels.size(); i += 4) {
+        if (blended.pixels[i + 3] > 0 && blended.pixels[i] > 0) bled = true;
+    }
+    ok(!bled, "transparent colour does not bleed");
+
+    try {
+        resize(bitmap{{2, 2}, 5, std::vector<std::uint8_t>(20)}, {1, 1});
+        fail("five channels accepted");
+    }
+    catch (std::invalid_argument &) {
+        pass("five channels rejected");
+    }
+
+    ok(!can_resample(u8"image/gif"), "GIF images are copied");
+
+#ifdef HAVE_LIBPNG
+    const std::filesystem::path source = "17-resample.png";
+
+    bitmap stripes{{400, 300}, 1, {}};
+    for (std::size_t y = 0; y < 300; ++y) {
+        for (std::size_t x = 0; x < 400; ++x) {
+            stripes.pixels.push_back(x / 10 % 2 ? 255 : 0);
+        }
+    }
+
+    png_image png{};
+    png.version = PNG_IMAGE_VERSION;
+    png.width = 400;
+    png.height = 300;
+    png.format = PNG_FORMAT_GRAY;
+    png_image_write_to_file(&png, source.c_str(), 0, stripes.pixels.data(),
+                            0, nullptr);
+
+    auto resampled = resample(source, u8"image/png", {200, 150});
+
+    ok(resampled.has_value(), "large PNG resampled");
+    eq(geom::size{200, 150},
+       resampled ? png_size(*resampled) : geom::size{}, "PNG size");
+    ok(!resample(source, u8"image/png", {400, 300}), "small PNG copied");
+
+    std::filesystem::remove(source);
+#else
+    plan.skip("built without libpng");
+    plan.skip("built without libpng");
+    plan.skip("built without libpng");
+#endif
+}
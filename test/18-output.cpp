@@ -0,0 +1,137 @@
+#include "output.hpp"
+#include "uring.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "tap.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+std::string contents(std::size_t i) {
+    // Include an empty file, and one too large for a single batch.
+    if (i == 0) return {};
+    if (i == 1) return std::string(1024 * 1024, 'x');
+    return "file " + std::to_string(i) + std::string(i % 700, '.');
+}
+
+std::string slurp(const fs::path &path) {
+    std::ifstream in{path, std::ios::binary};
+    return {std::istreambuf_iterator<char>{in}, {}};
+}
+
+} // namespace
+
+int main(int, const char **argv) {
+    using namespace tap;
+
+    auto root = fs::temp_directory_path() / fs::path(argv[0]).filename();
+
+    test_plan plan;
+
+    try {
+        fs::remove_all(root);
+        create_directories(root / "sources");
+
+        const std::size_t files = 300, copies = 100;
+
+        for (std::size_t i = 0; i < copies; ++i) {
+            std::ofstream{root / "sources" / std::to_string(i),
+                          std::ios::binary}
+                << contents(i);
+        }
+
+        diag("io_uring ", epub::uring::available() ? "is" : "is not",
+             " available");
+
+        for (bool io_uring : {false, true}) {
+            for (unsigned jobs : {1U, 4U}) {
+                auto what = std::string{io_uring ? "io_uring" : "threads"} +
+                            ", jobs=" + std::to_string(jobs) + ": ";
+                auto book = root / "book";
+
+                auto out = epub::open_output(
+                    book, {.jobs = jobs, .io_uring = io_uring});
+                for (std::size_t i = 0; i < files; ++i) {
+                    out->write("Contents/" + std::to_string(i % 7) + "/f" +
+                                   std::to_string(i),
+                               contents(i));
+                }
+                for (std::size_t i = 0; i < copies; ++i) {
+                    out->copy("Images/" + std::to_string(i),
+                              root / "sources" / std::to_string(i));
+                }
+                out->close();
+
+                bool written = true;
+                for (std::size_t i = 0; i < files; ++i) {
+                    written = written &&
+                              slurp(book / "Contents" / std::to_string(i % 7) /
+                                    ("f" + std::to_string(i))) == contents(i);
+                }
+                ok(written, what, "files written");
+
+                bool copied = true;
+                for (std::size_t i = 0; i < copies; ++i) {
+                    copied = copied && slurp(book / "Images" /
+                                             std::to_string(i)) == contents(i);
+                }
+                ok(copied, what, "files copied");
+
+                eq(slurp(book / "mimetype"), "application/epub+zip", what,
+                   "mimetype");
+
+                try {
+                    auto bad = epub::open_output(
+                        root / "bad", {.jobs = jobs, .io_uring = io_uring});
+                    bad->copy("Images/missing", root / "missing");
+                    bad->close();
+                    fail(what, "missing source accepted");
+                }
+                catch (fs::filesystem_error &e) {
+                    eq(e.path1(), root / "missing", what,
+                       "missing source reported");
+                }
+
+                fs::remove_all(book);
+                fs::remove_all(root / "bad");
+            }
+        }
+
+        if (epub::uring::available()) {
+            create_directories(root / "direct");
+
+            std::vector<epub::uring::file_write> batch;
+            for (std::size_t i = 0; i < 40; ++i) {
+                batch.push_back({root / "direct" / std::to_string(i),
+                                 contents(i)});
+            }
+            batch[5].path = root / "no such directory" / "5";
+
+            try {
+                epub::uring::write_files(batch);
+                fail("write into a missing directory accepted");
+            }
+            catch (fs::filesystem_error &e) {
+                eq(e.path1(), batch[5].path, "failed write reported");
+            }
+
+            ok(slurp(batch[39].path) == contents(39),
+               "rest of the batch written");
+        }
+        else {
+            plan.skip("io_uring is not available");
+            plan.skip("io_uring is not available");
+        }
+    }
+    catch (...) {
+        bail_out(std::current_exception());
+    }
+
+    fs::remove_all(root);
+}
@@ -0,0 +1,72 @@
+// Times fitting a million synthetic frames to a page, one at a time
+// and with the batch kernel, and checks that both agree.  Not run by
+// "make check"; build it with "make -C test bench-fit" and run it as
+//
+//     test/bench-fit [count]
+
+#include "geom_batch.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+template <class Fn>
+double run(unsigned rounds, Fn &&fn) {
+    auto start = std::chrono::steady_clock::now();
+
+    for (unsigned i = 0; i < rounds; ++i) fn();
+
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return elapsed.count() / rounds;
+}
+
+} // namespace
+
+int main(int argc, const char **argv) {
+    std::size_t count = argc > 1 ? std::atol(argv[1]) : 1000000;
+    constexpr unsigned rounds = 20;
+
+    std::vector<coord> w, h;
+    std::uint64_t state = 1;
+
+    for (std::size_t i = 0; i < count; ++i) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        w.push_back(100 + (state >> 33) % 4000);
+        h.push_back(100 + (state >> 13) % 4000);
+    }
+
+    const geom::size page{1536, 2048};
+    auto ws = w, hs = h, wb = w, hb = h;
+
+    // Each round starts from the synthetic sizes, so that every round
+    // does the same work.
+    auto scalar = run(rounds, [&] {
+        ws = w;
+        hs = h;
+        fit_sizes_scalar(ws, hs, page);
+    });
+    auto batch = run(rounds, [&] {
+        wb = w;
+        hb = h;
+        fit_sizes(wb, hb, page);
+    });
+    auto copy = run(rounds, [&] {
+        wb = w;
+        hb = h;
+    });
+
+    fit_sizes(wb, hb, page);
+
+    std::cout << count << " frames\n"
+              << "scalar: " << (scalar - copy) * 1e3 << " ms\n"
+              << fit_sizes_isa() << ": " << (batch - copy) * 1e3 << " ms\n"
+              << (ws == wb && hs == hb ? "identical" : "DIFFERENT")
+              << std::endl;
+
+    return ws == wb && hs == hb ? 0 : 1;
+}
@@ -0,0 +1,48 @@
+// Times adding items to an empty manifest, for a count and for ten
+// times that count, to show that insertion is close to linear.  Not
+// run by "make check"; build it with "make -C test bench-manifest"
+// and run it as
+//
+//     test/bench-manifest [count]
+
+#include "package.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+namespace {
+
+// Time adding @p count items to an empty manifest.
+double fill_manifest(std::size_t count) {
+    epub::package p;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (std::size_t i = 0; i < count; ++i) {
+        auto name = std::to_string(i);
+        p.add_to_manifest({
+            .id = u8"pg" + std::u8string{name.begin(), name.end()},
+            .path = "pg" + name + ".xhtml",
+        });
+    }
+
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+} // namespace
+
+int main(int argc, const char **argv) {
+    std::size_t count = argc > 1 ? std::atol(argv[1]) : 100000;
+
+    auto small = fill_manifest(count);
+    auto large = fill_manifest(10 * count);
+
+    std::cout << count << " items: " << small << " s\n"
+              << 10 * count << " items: " << large << " s\n"
+              << "ratio: " << large / small
+              << " (10 is linear, 100 quadratic)" << std::endl;
+}
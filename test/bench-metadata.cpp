@@ -0,0 +1,54 @@
+// Times extracting the head metadata of an XHTML document: with the
+// DOM reference implementation, which parses the whole document and
+// queries it with XPath, and with the head-only reader.  Not run by
+// "make check"; build it with "make -C test bench-metadata" and run
+// it as
+//
+//     test/bench-metadata [count]
+
+#include "xml.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+template <class Fn>
+double run(unsigned count, Fn &&fn) {
+    auto start = std::chrono::steady_clock::now();
+
+    for (unsigned i = 0; i < count; ++i) fn();
+
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+void report(const char *label, unsigned count, double seconds) {
+    std::cout << label << ": " << seconds * 1e6 / count << " us/document"
+              << std::endl;
+}
+
+} // namespace
+
+int main(int argc, const char **argv) {
+    using namespace epub::xml;
+
+    unsigned count = argc > 1 ? std::atoi(argv[1]) : 10000;
+
+    auto path = fs::path{TESTDIR} / "pach1.xhtml";
+
+    report("dom (parsed)", count, run(count, [&] {
+               epub::file_metadata metadata;
+               dom::get_xhtml_metadata(path, metadata);
+           }));
+
+    report("head reader ", count, run(count, [&] {
+               epub::file_metadata metadata;
+               get_xhtml_metadata(path, metadata);
+           }));
+}
@@ -0,0 +1,112 @@
+// Times writing many small files, and copying many small images, into
+// an expanded container: one file at a time (the plain save and copy
+// path), on four worker threads, and through io_uring.  Each time is
+// the best of three runs.  Not run by "make check"; build it with
+// "make -C test bench-output" and run it as
+//
+//     test/bench-output [count [copies]]
+//
+// The files are written under $TMPDIR, if it is set.
+
+#include "output.hpp"
+#include "uring.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct backend {
+    const char *name;
+    unsigned jobs;
+    bool io_uring;
+};
+
+template <class Fn>
+double time(const fs::path &path, const backend &b, Fn fn) {
+    double best = 0;
+
+    for (int run = 0; run < 3; ++run) {
+        fs::remove_all(path);
+
+        auto start = std::chrono::steady_clock::now();
+
+        auto out = epub::open_output(path,
+                                     {.jobs = b.jobs, .io_uring = b.io_uring});
+        fn(*out);
+        out->close();
+
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+        if (run == 0 || elapsed.count() < best) best = elapsed.count();
+    }
+
+    fs::remove_all(path);
+    return best;
+}
+
+void report(const char *what, const backend &b, unsigned count,
+            double seconds) {
+    std::cout << what << ' ' << b.name << ": " << count << " files in "
+              << seconds << " s (" << count / seconds << " files/s)"
+              << std::endl;
+}
+
+} // namespace
+
+int main(int argc, const char **argv) {
+    unsigned count = argc > 1 ? std::atoi(argv[1]) : 50000;
+    unsigned copies = argc > 2 ? std::atoi(argv[2]) : count / 10;
+
+    auto path = fs::temp_directory_path() / "bench-output";
+    auto sources = fs::temp_directory_path() / "bench-output-sources";
+
+    // About the size of a generated comic page, and of a small image.
+    std::string page(600, 'x');
+    std::string image(16 * 1024, 'x');
+
+    fs::remove_all(sources);
+    create_directories(sources);
+    for (unsigned i = 0; i < copies; ++i) {
+        std::ofstream{sources / std::to_string(i), std::ios::binary} << image;
+    }
+
+    if (!epub::uring::available()) {
+        std::cout << "io_uring is unavailable; its runs use threads"
+                  << std::endl;
+    }
+
+    const backend backends[] = {
+        {"save", 1, false},
+        {"threads", 4, false},
+        {"io_uring", 1, true},
+        {"io_uring+threads", 4, true},
+    };
+
+    for (auto &&b : backends) {
+        auto seconds = time(path, b, [&](epub::output &out) {
+            for (unsigned i = 0; i < count; ++i) {
+                out.write("Contents/pg" + std::to_string(i) + ".xhtml", page);
+            }
+        });
+        report("write", b, count, seconds);
+    }
+
+    for (auto &&b : backends) {
+        auto seconds = time(path, b, [&](epub::output &out) {
+            for (unsigned i = 0; i < copies; ++i) {
+                auto name = std::to_string(i);
+                out.copy("Images/img" + name + ".jpeg", sources / name);
+            }
+        });
+        report("copy", b, copies, seconds);
+    }
+
+    fs::remove_all(sources);
+}
@@ -0,0 +1,75 @@
+// Times reading image headers with imageinfo's stream reader and with
+// mapped_reader, and counts the reads imageinfo asks each to make.  Not
+// run by "make check"; build it with "make -C test bench-probe" and run
+// it over a mix of images, e.g.
+//
+//     test/bench-probe *.jpeg *.png *.webp *.gif
+//
+// For system call counts, run it under "strace -c -f".
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wall"
+#pragma clang diagnostic ignored "-Wextra"
+#include "imageinfo.hpp"
+#pragma clang diagnostic pop
+
+#include "mapped_reader.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+template <class Reader>
+struct counting : Reader {
+    static inline std::size_t reads = 0;
+
+    using Reader::Reader;
+
+    void read(void *buf, off_t offset, std::size_t size) {
+        ++reads;
+        Reader::read(buf, offset, size);
+    }
+};
+
+template <class Reader>
+void run(const char *label, const std::vector<std::string> &paths,
+         unsigned rounds) {
+    counting<Reader>::reads = 0;
+    std::size_t recognized = 0;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (unsigned i = 0; i < rounds; ++i) {
+        for (auto &&path : paths) {
+            if (imageinfo::parse<counting<Reader>>(path)) ++recognized;
+        }
+    }
+
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    auto files = paths.size() * rounds;
+
+    std::cout << label << ": " << elapsed.count() * 1e6 / files
+              << " us/file, " << double(counting<Reader>::reads) / files
+              << " reads/file, " << recognized << '/' << files
+              << " recognized" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, const char **argv) {
+    std::vector<std::string> paths(argv + 1, argv + argc);
+
+    if (paths.empty()) {
+        std::cerr << "usage: bench-probe image-file..." << std::endl;
+        return 1;
+    }
+
+    const unsigned rounds = 100;
+
+    run<imageinfo::FilePathReader>("stream", paths, rounds);
+    run<epub::comic::mapped_reader>("mapped", paths, rounds);
+}